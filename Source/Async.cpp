@@ -0,0 +1,275 @@
+#include "Async.hpp"
+
+#ifdef PYRITE_ENABLE_COROUTINES
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace py {
+// How long the waiter blocks on fences before looking for new waits. Fences can't be signaled from the host, so
+// unlike with timeline semaphores there is no way to wake it up early.
+static constexpr std::chrono::nanoseconds FencePollInterval = std::chrono::milliseconds(1);
+
+// How often the destructor reports the coroutines it is still waiting for, so that a hang on shutdown is visible.
+static constexpr std::chrono::seconds ShutdownReportInterval { 1 };
+
+// Runs a task to completion with nobody awaiting it, then destroys itself.
+struct DetachedTask {
+	struct promise_type {
+		DetachedTask get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+static DetachedTask RunDetached(Task<void> task) {
+	co_await task;
+}
+
+void Detach(Task<void> task) {
+	RunDetached(std::move(task));
+}
+
+vk::UniqueSemaphore BuildTimelineSemaphore(vk::Device const& device, uint64_t initialValue) {
+	vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfoKHR> createInfo {
+		vk::SemaphoreCreateInfo {},
+		vk::SemaphoreTypeCreateInfoKHR { vk::SemaphoreTypeKHR::eTimeline, initialValue }
+	};
+	return device.createSemaphoreUnique(createInfo.get<vk::SemaphoreCreateInfo>());
+}
+
+GpuScheduler::GpuScheduler(
+	vk::Device const& device,
+	vk::Queue const& queue,
+	uint32_t queueFamilyIndex,
+	bool timelineSemaphoresEnabled,
+	size_t workerCount
+) : device(device), queue(queue), queueFamilyIndex(queueFamilyIndex), timelineSemaphoresEnabled(timelineSemaphoresEnabled) {
+	if (timelineSemaphoresEnabled) {
+		wakeSemaphore = BuildTimelineSemaphore(device, 0);
+	}
+
+	waiter = std::thread(&GpuScheduler::WaitLoop, this);
+	workers.reserve(std::max<size_t>(1, workerCount));
+	for (size_t i = 0; i < std::max<size_t>(1, workerCount); ++i) {
+		workers.emplace_back(&GpuScheduler::WorkLoop, this);
+	}
+}
+
+GpuScheduler::~GpuScheduler() {
+	{
+		// Stopping any earlier would leak the frames of the coroutines still waiting, along with whatever GPU objects
+		// they own.
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!idle.wait_for(lock, ShutdownReportInterval, [&] { return outstanding == 0; })) {
+			std::cerr << "[Async] Waiting for " << outstanding << " coroutines to finish before shutting down" << std::endl;
+		}
+		stopping = true;
+		if (wakeSemaphore) {
+			device.signalSemaphoreKHR({ *wakeSemaphore, ++wakeValue });
+		}
+	}
+	waitAdded.notify_all();
+	workAdded.notify_all();
+
+	waiter.join();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void GpuScheduler::Submit(vk::SubmitInfo const& submitInfo, vk::Fence const& fence) {
+	std::lock_guard<std::mutex> lock(queueMutex);
+	queue.submit(submitInfo, fence);
+}
+
+void GpuScheduler::Resume(std::coroutine_handle<> handle) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		outstanding++;
+		readyHandles.push_back(handle);
+	}
+	workAdded.notify_one();
+}
+
+void GpuScheduler::AddWait(PendingWait const& wait) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		outstanding++;
+		incomingWaits.push_back(wait);
+		if (wakeSemaphore) {
+			// Signaled under the lock so that the values stay in order.
+			device.signalSemaphoreKHR({ *wakeSemaphore, ++wakeValue });
+		}
+	}
+	waitAdded.notify_one();
+}
+
+void GpuScheduler::RequireTimelineSemaphores() const {
+	if (!timelineSemaphoresEnabled) {
+		throw std::logic_error("timeline semaphores are not enabled on the scheduler's device");
+	}
+}
+
+bool GpuScheduler::IsComplete(PendingWait const& wait) const {
+	if (wait.Fence) {
+		return device.getFenceStatus(wait.Fence) == vk::Result::eSuccess;
+	}
+	return device.getSemaphoreCounterValueKHR(wait.Semaphore) >= wait.Value;
+}
+
+void GpuScheduler::BlockOnAny(std::vector<PendingWait> const& waits) {
+	std::vector<vk::Fence> fences;
+	std::vector<vk::Semaphore> semaphores;
+	std::vector<uint64_t> values;
+	for (PendingWait const& wait : waits) {
+		if (wait.Fence) {
+			fences.push_back(wait.Fence);
+		} else {
+			semaphores.push_back(wait.Semaphore);
+			values.push_back(wait.Value);
+		}
+	}
+
+	if (wakeSemaphore) {
+		semaphores.push_back(*wakeSemaphore);
+		values.push_back(observedWakeValue + 1);
+	}
+
+	uint64_t pollTimeout = static_cast<uint64_t>(FencePollInterval.count());
+	if (!semaphores.empty()) {
+		// With fences in the mix we can't sleep until a semaphore is signaled, so fall back to polling them.
+		vk::SemaphoreWaitInfoKHR waitInfo {
+			vk::SemaphoreWaitFlagBitsKHR::eAny,
+			static_cast<uint32_t>(semaphores.size()), semaphores.data(),
+			values.data()
+		};
+		device.waitSemaphoresKHR(waitInfo, fences.empty() ? std::numeric_limits<uint64_t>::max() : pollTimeout);
+	} else {
+		device.waitForFences(fences, false, pollTimeout);
+	}
+
+	if (wakeSemaphore) {
+		observedWakeValue = device.getSemaphoreCounterValueKHR(*wakeSemaphore);
+	}
+}
+
+void GpuScheduler::WaitLoop() {
+	// Only ever touched by this thread.
+	std::vector<PendingWait> pending;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (pending.empty()) {
+				waitAdded.wait(lock, [&] { return stopping || !incomingWaits.empty(); });
+			}
+			// Nothing can be left to wait on, the destructor only stops once every coroutine has been resumed.
+			if (stopping) {
+				return;
+			}
+			pending.insert(pending.end(), incomingWaits.cbegin(), incomingWaits.cend());
+			incomingWaits.clear();
+		}
+
+		auto completed = std::stable_partition(pending.begin(), pending.end(),
+			[&](PendingWait const& wait) { return !IsComplete(wait); }
+		);
+		if (completed != pending.end()) {
+			{
+				// Still counted as outstanding until a worker has resumed them.
+				std::lock_guard<std::mutex> lock(mutex);
+				for (auto it = completed; it != pending.end(); ++it) {
+					readyHandles.push_back(it->Handle);
+				}
+			}
+			workAdded.notify_all();
+			pending.erase(completed, pending.end());
+		}
+
+		if (!pending.empty()) {
+			BlockOnAny(pending);
+		}
+	}
+}
+
+void GpuScheduler::WorkLoop() {
+	while (true) {
+		std::coroutine_handle<> handle;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAdded.wait(lock, [&] { return stopping || !readyHandles.empty(); });
+			if (readyHandles.empty()) {
+				return;
+			}
+			handle = readyHandles.front();
+			readyHandles.pop_front();
+		}
+		handle.resume();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--outstanding == 0) {
+			idle.notify_all();
+		}
+	}
+}
+
+Task<Buffer> Upload(
+	GpuScheduler& scheduler,
+	MemoryTelemetry& telemetry,
+	std::vector<uint8_t> data,
+	vk::BufferUsageFlags usage,
+	MemoryTag tag
+) {
+	if (data.empty()) {
+		throw std::invalid_argument("cannot upload an empty buffer");
+	}
+	co_await scheduler.Schedule();
+
+	vk::Device const& device = scheduler.Device();
+	vk::DeviceSize size = data.size();
+	Buffer staging = Buffer::Build(
+		telemetry, device,
+		size,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		tag
+	);
+	std::memcpy(staging.Mapped, data.data(), data.size());
+
+	Buffer buffer = Buffer::Build(
+		telemetry, device,
+		size,
+		usage | vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		tag
+	);
+
+	// Command pools can't be shared between threads, so every upload brings its own.
+	vk::UniqueCommandPool commandPool = device.createCommandPoolUnique({
+		vk::CommandPoolCreateFlagBits::eTransient,
+		scheduler.QueueFamilyIndex()
+	});
+	std::vector<vk::UniqueCommandBuffer> commandBuffers = device.allocateCommandBuffersUnique(
+		{ *commandPool, vk::CommandBufferLevel::ePrimary, 1 }
+	);
+	vk::CommandBuffer commandBuffer = *commandBuffers.front();
+	commandBuffer.begin(vk::CommandBufferBeginInfo { vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	commandBuffer.copyBuffer(*staging.Handle, *buffer.Handle, vk::BufferCopy { 0, 0, size });
+	commandBuffer.end();
+
+	vk::UniqueFence fence = device.createFenceUnique({});
+	scheduler.Submit(vk::SubmitInfo { 0, nullptr, nullptr, 1, &commandBuffer }, *fence);
+	co_await scheduler.WaitFor(*fence);
+
+	co_return std::move(buffer);
+}
+}
+
+#endif
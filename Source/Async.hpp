@@ -0,0 +1,284 @@
+#pragma once
+
+// The coroutine layer needs C++20, so it is only built when configured with PYRITE_ENABLE_COROUTINES=ON.
+#ifdef PYRITE_ENABLE_COROUTINES
+
+#include "Vulkan.hpp"
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace py {
+template <typename T>
+class Task;
+
+// Hands control straight back to whoever awaited a finished task, without growing the stack.
+struct TaskFinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        std::coroutine_handle<> continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+};
+
+// State shared by the promises of every Task, whatever it returns.
+class TaskPromiseBase {
+public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    TaskFinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object();
+
+    void return_value(T value) { result.emplace(std::move(value)); }
+
+    T TakeResult() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*result);
+    }
+
+private:
+    std::optional<T> result;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+
+    void return_void() {}
+
+    void TakeResult() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+// A lazily started coroutine that produces a T. It runs once it is awaited, and the awaiting coroutine is resumed
+// on whichever thread the task finishes on. Exceptions are rethrown at the co_await.
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const {
+        if (!handle) {
+            throw std::logic_error("awaited an empty task");
+        }
+        return handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().TakeResult(); }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Starts a task without anyone awaiting it. The task owns itself and is destroyed when it finishes; it must handle
+// its own errors, as an escaping exception terminates the program.
+void Detach(Task<void> task);
+
+// A value a timeline semaphore will reach once some GPU work has completed.
+struct TimelineValue {
+    vk::Semaphore Semaphore;
+    uint64_t Value;
+};
+
+vk::UniqueSemaphore BuildTimelineSemaphore(vk::Device const &device, uint64_t initialValue);
+
+// Resumes coroutines on a pool of worker threads, either right away or once a fence or timeline semaphore they
+// await has been signaled. A single waiter thread blocks on all outstanding GPU work at once, so no other thread
+// ever waits on the GPU.
+class GpuScheduler {
+public:
+    // Timeline semaphores can only be awaited if VK_KHR_timeline_semaphore and its feature are enabled on the
+    // device. The scheduler takes over submission to the queue; anyone else submitting to it from another thread
+    // must go through Submit() as well.
+    GpuScheduler(
+        vk::Device const &device,
+        vk::Queue const &queue,
+        uint32_t queueFamilyIndex,
+        bool timelineSemaphoresEnabled,
+        size_t workerCount = 2
+    );
+
+    // Blocks until the scheduler no longer holds any coroutine, i.e. every one it was asked to resume has been resumed
+    // and has either finished or suspended on something else. Every fence and timeline value awaited through it must
+    // therefore eventually be signaled, or this never returns; while it waits, it reports how many coroutines are
+    // left. Must not be called from one of its worker threads.
+    ~GpuScheduler();
+
+    GpuScheduler(GpuScheduler const &) = delete;
+    GpuScheduler &operator=(GpuScheduler const &) = delete;
+
+    vk::Device const &Device() const { return device; }
+    uint32_t QueueFamilyIndex() const { return queueFamilyIndex; }
+
+    void Submit(vk::SubmitInfo const &submitInfo, vk::Fence const &fence);
+
+    // co_await Schedule() continues the coroutine on a worker thread.
+    auto Schedule() {
+        struct ScheduleAwaiter {
+            GpuScheduler &scheduler;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { scheduler.Resume(handle); }
+            void await_resume() const noexcept {}
+        };
+        return ScheduleAwaiter { *this };
+    }
+
+    // co_await WaitFor(fence) continues the coroutine on a worker thread once the fence is signaled, or right away
+    // on the current thread if it already is.
+    auto WaitFor(vk::Fence const &fence) {
+        struct FenceAwaiter {
+            GpuScheduler &scheduler;
+            vk::Fence fence;
+
+            bool await_ready() const { return scheduler.device.getFenceStatus(fence) == vk::Result::eSuccess; }
+            void await_suspend(std::coroutine_handle<> handle) { scheduler.AddWait({ fence, {}, 0, handle }); }
+            void await_resume() const noexcept {}
+        };
+        return FenceAwaiter { *this, fence };
+    }
+
+    // Like WaitFor(fence), for a timeline semaphore reaching a value.
+    auto WaitFor(TimelineValue const &value) {
+        struct TimelineAwaiter {
+            GpuScheduler &scheduler;
+            TimelineValue value;
+
+            bool await_ready() const {
+                return scheduler.device.getSemaphoreCounterValueKHR(value.Semaphore) >= value.Value;
+            }
+            void await_suspend(std::coroutine_handle<> handle) {
+                scheduler.AddWait({ {}, value.Semaphore, value.Value, handle });
+            }
+            void await_resume() const noexcept {}
+        };
+        RequireTimelineSemaphores();
+        return TimelineAwaiter { *this, value };
+    }
+
+private:
+    // A coroutine waiting on either a fence or a timeline semaphore.
+    struct PendingWait {
+        vk::Fence Fence;
+        vk::Semaphore Semaphore;
+        uint64_t Value;
+        std::coroutine_handle<> Handle;
+    };
+
+    void Resume(std::coroutine_handle<> handle);
+    void AddWait(PendingWait const &wait);
+    void RequireTimelineSemaphores() const;
+    bool IsComplete(PendingWait const &wait) const;
+    void BlockOnAny(std::vector<PendingWait> const &waits);
+    void WaitLoop();
+    void WorkLoop();
+
+    vk::Device device;
+    vk::Queue queue;
+    uint32_t queueFamilyIndex;
+    bool timelineSemaphoresEnabled;
+    std::mutex queueMutex;
+
+    // Signaled from the host whenever a wait is added, so that the waiter thread picks it up right away.
+    vk::UniqueSemaphore wakeSemaphore;
+    uint64_t wakeValue = 0;
+    uint64_t observedWakeValue = 0;
+
+    std::mutex mutex;
+    std::condition_variable waitAdded;
+    std::condition_variable workAdded;
+    std::vector<PendingWait> incomingWaits;
+    std::deque<std::coroutine_handle<>> readyHandles;
+    bool stopping = false;
+
+    // Coroutines that are queued, waited on or being resumed by the scheduler.
+    size_t outstanding = 0;
+    std::condition_variable idle;
+
+    std::thread waiter;
+    std::vector<std::thread> workers;
+};
+
+// Copies the data into a new device local buffer through a staging buffer. The copy is recorded and submitted on
+// a worker thread, and the coroutine resumes once it has completed on the GPU. Waiting on the host doesn't make the
+// copy visible to later submissions, so the first one that uses the buffer must still begin with a barrier from the
+// transfer stage's transfer writes to its own stage and access.
+Task<Buffer> Upload(
+    GpuScheduler &scheduler,
+    MemoryTelemetry &telemetry,
+    std::vector<uint8_t> data,
+    vk::BufferUsageFlags usage,
+    MemoryTag tag
+);
+
+// Runs build(device), which creates one or more pipelines, on a worker thread so that shader compilation in the
+// driver never blocks the caller. The coroutine resumes on that worker with the result.
+template <typename Build>
+auto CompilePipeline(GpuScheduler &scheduler, Build build) -> Task<std::invoke_result_t<Build &, vk::Device const &>> {
+    co_await scheduler.Schedule();
+    co_return build(scheduler.Device());
+}
+}
+
+#endif
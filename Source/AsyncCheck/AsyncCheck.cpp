@@ -0,0 +1,233 @@
+#include <vulkan/vulkan.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Async.hpp"
+#include "ClusteredLighting.hpp"
+#include "DebugMessageSink.hpp"
+#include "MemoryTelemetry.hpp"
+#include "ParticleSystem.hpp"
+#include "Scene.hpp"
+#include "Vulkan.hpp"
+
+using namespace py;
+
+static bool Report(char const* name, bool passed) {
+	std::cerr << "[Async] " << name << (passed ? ": passed" : ": FAILED") << std::endl;
+	return passed;
+}
+
+// Copies the buffer back into host visible memory and compares it with what was uploaded. The copy is awaited on a
+// timeline semaphore or on a fence, so that both of the scheduler's wait paths are covered.
+static Task<bool> ReadBack(
+	GpuScheduler& scheduler,
+	MemoryTelemetry& telemetry,
+	Buffer const& source,
+	std::vector<uint8_t> const& expected,
+	bool useTimeline
+) {
+	co_await scheduler.Schedule();
+
+	vk::Device const& device = scheduler.Device();
+	Buffer readback = Buffer::Build(
+		telemetry, device,
+		expected.size(),
+		vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		MemoryTag::Other
+	);
+
+	vk::UniqueCommandPool commandPool = device.createCommandPoolUnique({
+		vk::CommandPoolCreateFlagBits::eTransient,
+		scheduler.QueueFamilyIndex()
+	});
+	std::vector<vk::UniqueCommandBuffer> commandBuffers = device.allocateCommandBuffersUnique(
+		{ *commandPool, vk::CommandBufferLevel::ePrimary, 1 }
+	);
+	vk::CommandBuffer commandBuffer = *commandBuffers.front();
+	commandBuffer.begin(vk::CommandBufferBeginInfo { vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+	// Waiting for the upload on the host doesn't order it with this submission on the device.
+	vk::MemoryBarrier fromUpload { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead };
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eTransfer,
+		{},
+		fromUpload, nullptr, nullptr
+	);
+	commandBuffer.copyBuffer(*source.Handle, *readback.Handle, vk::BufferCopy { 0, 0, expected.size() });
+
+	// Completing the submission doesn't make the copy visible to the host by itself.
+	vk::MemoryBarrier toHost { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead };
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eHost,
+		{},
+		toHost, nullptr, nullptr
+	);
+	commandBuffer.end();
+
+	if (useTimeline) {
+		vk::UniqueSemaphore timeline = BuildTimelineSemaphore(device, 0);
+		uint64_t signalValue = 1;
+		vk::TimelineSemaphoreSubmitInfoKHR timelineInfo { 0, nullptr, 1, &signalValue };
+		vk::SubmitInfo submitInfo { 0, nullptr, nullptr, 1, &commandBuffer, 1, &*timeline };
+		submitInfo.pNext = &timelineInfo;
+		scheduler.Submit(submitInfo, {});
+		co_await scheduler.WaitFor(TimelineValue { *timeline, signalValue });
+	} else {
+		vk::UniqueFence fence = device.createFenceUnique({});
+		scheduler.Submit(vk::SubmitInfo { 0, nullptr, nullptr, 1, &commandBuffer }, *fence);
+		co_await scheduler.WaitFor(*fence);
+	}
+
+	co_return std::memcmp(readback.Mapped, expected.data(), expected.size()) == 0;
+}
+
+static Task<bool> RunChecks(GpuScheduler& scheduler, MemoryTelemetry& telemetry, bool timelineSemaphoresEnabled) {
+	bool passed = true;
+
+	bool emptyTaskRejected = false;
+	try {
+		Task<void> empty;
+		co_await empty;
+	} catch (std::logic_error const&) {
+		emptyTaskRejected = true;
+	}
+	passed &= Report("awaiting an empty task", emptyTaskRejected);
+
+	std::vector<uint8_t> data(64 * 1024);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<uint8_t>(i * 31 + 7);
+	}
+	Buffer uploaded = co_await Upload(scheduler, telemetry, data, vk::BufferUsageFlagBits::eTransferSrc, MemoryTag::Other);
+
+	bool fenceReadback = co_await ReadBack(scheduler, telemetry, uploaded, data, false);
+	passed &= Report("upload and readback awaited on fences", fenceReadback);
+
+	if (timelineSemaphoresEnabled) {
+		bool timelineReadback = co_await ReadBack(scheduler, telemetry, uploaded, data, true);
+		passed &= Report("readback awaited on a timeline semaphore", timelineReadback);
+	} else {
+		std::cerr << "[Async] Timeline semaphores are not supported by the device, skipping their check" << std::endl;
+	}
+
+	// The layouts are built up front, only the pipelines themselves are compiled on a worker.
+	ClusteredLighting lighting(telemetry, scheduler.Device(), 1, 16);
+	ParticleSettings particleSettings;
+	particleSettings.Capacity = 1024;
+	ParticleSystem particles(telemetry, scheduler.Device(), particleSettings);
+	ScenePipelines scene = co_await CompilePipeline(scheduler, [&](vk::Device const& device) {
+		return ScenePipelines::Build(device, vk::Format::eR8G8B8A8Unorm, lighting.SetLayout(), particles.SetLayout());
+	});
+	passed &= Report("pipelines compiled on a worker", scene.Pipeline && scene.ParticlePipeline);
+
+	co_return passed;
+}
+
+// Hands the result of the checks over to the thread that started them.
+static Task<void> Complete(Task<bool> checks, std::promise<bool>& result) {
+	try {
+		result.set_value(co_await checks);
+	} catch (...) {
+		result.set_exception(std::current_exception());
+	}
+}
+
+static bool RunAsyncCheck(
+	vk::Device const& device,
+	vk::Queue const& queue,
+	uint32_t queueFamilyIndex,
+	bool timelineSemaphoresEnabled,
+	MemoryTelemetry& telemetry
+) {
+	std::promise<bool> result;
+	std::future<bool> passed = result.get_future();
+
+	// Destroyed first, which waits for the checks to have completely finished on its workers.
+	GpuScheduler scheduler(device, queue, queueFamilyIndex, timelineSemaphoresEnabled);
+	Detach(Complete(RunChecks(scheduler, telemetry, timelineSemaphoresEnabled), result));
+	return passed.get();
+}
+
+// Drives the coroutine layer against the first device with a graphics queue: an upload, readbacks awaited on a fence
+// and on a timeline semaphore, and pipelines compiled on a worker thread. Exits with a failure if any of them don't
+// behave.
+int main() {
+	int result = EXIT_SUCCESS;
+	try {
+		InitializeDefaultDispatcher();
+		vk::ApplicationInfo appInfo = BuildApplicationInfo(VK_API_VERSION_1_1);
+		// Must outlive the instance, which reports to it until it is destroyed. Only built when debugging, as its logger
+		// thread would otherwise run for nothing.
+		std::optional<DebugMessageSink> debugSink;
+#ifdef NDEBUG
+		vk::UniqueInstance instance = InitializeVulkan(appInfo, {}, {}, false, nullptr);
+#else
+		debugSink.emplace();
+		vk::UniqueInstance instance = InitializeVulkan(
+			appInfo,
+			{ VK_EXT_DEBUG_UTILS_EXTENSION_NAME },
+			{ "VK_LAYER_KHRONOS_validation" },
+			true,
+			&*debugSink
+		);
+		vk::UniqueDebugUtilsMessengerEXT debugMessenger =
+			instance->createDebugUtilsMessengerEXTUnique(BuildDebugMessengerCreateInfo(&*debugSink));
+#endif
+
+		PhysicalDeviceDetails physicalDeviceDetails = ChooseHeadlessPhysicalDevice(*instance);
+		std::cerr << "[Async] Using " << physicalDeviceDetails.Properties.deviceName << std::endl;
+
+		// Devices that expose the extension must support its feature.
+		std::vector<std::string> deviceExtensions;
+		vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures { VK_TRUE };
+		void const* deviceNext = nullptr;
+		if (physicalDeviceDetails.HasTimelineSemaphore) {
+			deviceExtensions.emplace_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			deviceNext = &timelineSemaphoreFeatures;
+		}
+		uint32_t graphicsFamilyIndex = physicalDeviceDetails.GraphicsFamilyIndex.value();
+#ifdef NDEBUG
+		vk::UniqueDevice device =
+			BuildDevice(physicalDeviceDetails.Device, { graphicsFamilyIndex }, deviceExtensions, {}, false, deviceNext);
+#else
+		vk::UniqueDevice device = BuildDevice(
+			physicalDeviceDetails.Device,
+			{ graphicsFamilyIndex },
+			deviceExtensions,
+			{ "VK_LAYER_KHRONOS_validation" },
+			true,
+			deviceNext
+		);
+#endif
+
+		// Must outlive every allocation, which reports to it when freed.
+		MemoryTelemetry memoryTelemetry(physicalDeviceDetails.Device, false);
+
+		bool passed = RunAsyncCheck(
+			*device,
+			device->getQueue(graphicsFamilyIndex, 0),
+			graphicsFamilyIndex,
+			physicalDeviceDetails.HasTimelineSemaphore,
+			memoryTelemetry
+		);
+		result = passed ? EXIT_SUCCESS : EXIT_FAILURE;
+	} catch (vk::SystemError const& e) {
+		std::cerr << "[Vulkan Fatal] " << e.what() << std::endl;
+		result = EXIT_FAILURE;
+	} catch (std::exception const& e) {
+		std::cerr << "[Fatal] " <<  e.what() << std::endl;
+		result = EXIT_FAILURE;
+	}
+
+	return result;
+}
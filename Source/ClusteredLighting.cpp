@@ -0,0 +1,248 @@
+#include "ClusteredLighting.hpp"
+
+#include "CommandLine.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace py {
+static std::vector<uint32_t> const LightCullingShaderIL {
+	#include "Shaders/LightCulling.comp.spv"
+};
+
+// Must match the local size in LightCulling.comp.
+static constexpr uint32_t CullingGroupSize = 128;
+
+// Matches the Counter block in LightCulling.comp.
+struct CullingCounters {
+	uint32_t NextIndex;
+	uint32_t DroppedLights;
+};
+
+static constexpr float NearPlane = 0.1f;
+static constexpr float FarPlane = 100.0f;
+
+SceneUniforms SceneUniforms::Build(
+	glm::vec3 const& cameraPosition,
+	glm::vec3 const& cameraTarget,
+	vk::Extent2D const& extent
+) {
+	float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+	glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), aspect, NearPlane, FarPlane);
+
+	// Vulkan's clip space has y pointing down.
+	projection[1][1] *= -1.0f;
+
+	return SceneUniforms {
+		glm::lookAtRH(cameraPosition, cameraTarget, glm::vec3 { 0.0f, 1.0f, 0.0f }),
+		projection,
+		glm::inverse(projection),
+		glm::vec4 { static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 0.0f },
+		glm::vec4 { NearPlane, FarPlane, std::log(FarPlane / NearPlane), 0.0f },
+		glm::uvec4 { 0, 0, 0, 0 }
+	};
+}
+
+LightingSettings LightingSettings::Parse(int argc, char** argv) {
+	LightingSettings settings;
+	for (int i = 1; i < argc; ++i) {
+		if (char const* value = OptionValue(argv[i], "--lights")) {
+			int lightCount = std::stoi(value);
+			if (lightCount < 0) {
+				throw std::runtime_error("--lights must not be negative");
+			}
+			settings.LightCount = static_cast<uint32_t>(lightCount);
+		}
+	}
+	return settings;
+}
+
+ClusteredLighting::ClusteredLighting(
+	MemoryTelemetry& telemetry,
+	vk::Device const& device,
+	uint32_t frameCount,
+	uint32_t maxLights
+) : maxLights(maxLights) {
+	vk::ShaderStageFlags sceneStages =
+		vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+	vk::ShaderStageFlags lightingStages = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+	std::array<vk::DescriptorSetLayoutBinding, 5> bindings {
+		vk::DescriptorSetLayoutBinding { 0, vk::DescriptorType::eUniformBuffer, 1, sceneStages },
+		vk::DescriptorSetLayoutBinding { 1, vk::DescriptorType::eStorageBuffer, 1, lightingStages },
+		vk::DescriptorSetLayoutBinding { 2, vk::DescriptorType::eStorageBuffer, 1, lightingStages },
+		vk::DescriptorSetLayoutBinding { 3, vk::DescriptorType::eStorageBuffer, 1, lightingStages },
+		vk::DescriptorSetLayoutBinding { 4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute }
+	};
+	setLayout = device.createDescriptorSetLayoutUnique({
+		{},
+		static_cast<uint32_t>(bindings.size()), bindings.data()
+	});
+
+	std::array<vk::DescriptorPoolSize, 2> poolSizes {
+		vk::DescriptorPoolSize { vk::DescriptorType::eUniformBuffer, frameCount },
+		vk::DescriptorPoolSize { vk::DescriptorType::eStorageBuffer, frameCount * 4 }
+	};
+	descriptorPool = device.createDescriptorPoolUnique({
+		{},
+		frameCount,
+		static_cast<uint32_t>(poolSizes.size()), poolSizes.data()
+	});
+
+	pipelineLayout = device.createPipelineLayoutUnique({ {}, 1, &*setLayout });
+
+	vk::UniqueShaderModule shaderModule = BuildShaderModule(device, LightCullingShaderIL);
+	vk::ComputePipelineCreateInfo pipelineInfo {
+		{},
+		vk::PipelineShaderStageCreateInfo {
+			{},
+			vk::ShaderStageFlagBits::eCompute,
+			*shaderModule,
+			"main"
+		},
+		*pipelineLayout
+	};
+	pipeline = device.createComputePipelineUnique({}, pipelineInfo);
+
+	std::vector<vk::DescriptorSetLayout> setLayouts(frameCount, *setLayout);
+	std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets({
+		*descriptorPool,
+		frameCount, setLayouts.data()
+	});
+
+	vk::MemoryPropertyFlags hostMemory =
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	vk::DeviceSize lightsSize = std::max<vk::DeviceSize>(1, maxLights) * sizeof(Light);
+
+	frames.reserve(frameCount);
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		Frame frame {
+			Buffer::Build(
+				telemetry, device,
+				sizeof(SceneUniforms),
+				vk::BufferUsageFlagBits::eUniformBuffer,
+				hostMemory,
+				MemoryTag::Lighting
+			),
+			Buffer::Build(
+				telemetry, device,
+				lightsSize,
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				hostMemory,
+				MemoryTag::Lighting
+			),
+			Buffer::Build(
+				telemetry, device,
+				ClusterCount * sizeof(glm::uvec2),
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+				MemoryTag::Lighting
+			),
+			// Enough for every cluster to be full, even though the lists are packed together.
+			Buffer::Build(
+				telemetry, device,
+				ClusterCount * MaxLightsPerCluster * sizeof(uint32_t),
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+				MemoryTag::Lighting
+			),
+			// Host visible so that the number of dropped lights can be read back.
+			Buffer::Build(
+				telemetry, device,
+				sizeof(CullingCounters),
+				vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+				hostMemory,
+				MemoryTag::Lighting
+			),
+			sets[i]
+		};
+		std::memset(frame.Counter.Mapped, 0, sizeof(CullingCounters));
+
+		std::array<vk::DescriptorBufferInfo, 5> bufferInfos {
+			vk::DescriptorBufferInfo { *frame.Uniforms.Handle, 0, VK_WHOLE_SIZE },
+			vk::DescriptorBufferInfo { *frame.Lights.Handle, 0, VK_WHOLE_SIZE },
+			vk::DescriptorBufferInfo { *frame.ClusterRanges.Handle, 0, VK_WHOLE_SIZE },
+			vk::DescriptorBufferInfo { *frame.LightIndices.Handle, 0, VK_WHOLE_SIZE },
+			vk::DescriptorBufferInfo { *frame.Counter.Handle, 0, VK_WHOLE_SIZE }
+		};
+		std::array<vk::WriteDescriptorSet, 5> writes;
+		for (uint32_t binding = 0; binding < writes.size(); ++binding) {
+			writes[binding] = vk::WriteDescriptorSet {
+				frame.Set,
+				binding,
+				0,
+				1,
+				bindings[binding].descriptorType,
+				nullptr,
+				&bufferInfos[binding]
+			};
+		}
+		device.updateDescriptorSets(writes, nullptr);
+
+		frames.emplace_back(std::move(frame));
+	}
+}
+
+void ClusteredLighting::Update(uint32_t frame, SceneUniforms uniforms, std::vector<Light> const& lights) {
+	uint32_t lightCount = std::min(maxLights, static_cast<uint32_t>(lights.size()));
+	uniforms.LightCount.x = lightCount;
+
+	std::memcpy(frames[frame].Uniforms.Mapped, &uniforms, sizeof(uniforms));
+
+	// Moving the lights into view space once here spares the culling pass and every shaded fragment from doing it.
+	Light* viewLights = static_cast<Light*>(frames[frame].Lights.Mapped);
+	glm::mat3 viewRotation(uniforms.View);
+	for (uint32_t i = 0; i < lightCount; ++i) {
+		Light const& light = lights[i];
+		glm::vec3 direction = glm::vec3(light.DirectionCosCone);
+		if (light.DirectionCosCone.w > -1.0f) {
+			direction = glm::normalize(viewRotation * direction);
+		}
+		viewLights[i] = Light {
+			glm::vec4 { glm::vec3(uniforms.View * glm::vec4 { glm::vec3(light.PositionRange), 1.0f }), light.PositionRange.w },
+			light.Color,
+			glm::vec4 { direction, light.DirectionCosCone.w }
+		};
+	}
+}
+
+uint32_t ClusteredLighting::DroppedLights(uint32_t frame) const {
+	return static_cast<CullingCounters const*>(frames[frame].Counter.Mapped)->DroppedLights;
+}
+
+void ClusteredLighting::RecordCulling(vk::CommandBuffer const& commandBuffer, uint32_t frame) const {
+	Frame const& resources = frames[frame];
+
+	commandBuffer.fillBuffer(*resources.Counter.Handle, 0, VK_WHOLE_SIZE, 0);
+	vk::MemoryBarrier counterReset {
+		vk::AccessFlagBits::eTransferWrite,
+		vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+	};
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eComputeShader,
+		{},
+		counterReset, nullptr, nullptr
+	);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, resources.Set, nullptr);
+	commandBuffer.dispatch((ClusterCount + CullingGroupSize - 1) / CullingGroupSize, 1, 1);
+
+	vk::MemoryBarrier listsWritten {
+		vk::AccessFlagBits::eShaderWrite,
+		vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eHostRead
+	};
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eHost,
+		{},
+		listsWritten, nullptr, nullptr
+	);
+}
+}
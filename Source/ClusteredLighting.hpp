@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Light.hpp"
+#include "Vulkan.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace py {
+// The dimensions of the froxel grid. Must match the constants in the lighting shaders.
+constexpr uint32_t ClusterCountX = 16;
+constexpr uint32_t ClusterCountY = 9;
+constexpr uint32_t ClusterCountZ = 24;
+constexpr uint32_t ClusterCount = ClusterCountX * ClusterCountY * ClusterCountZ;
+constexpr uint32_t MaxLightsPerCluster = 64;
+
+// Per-frame scene constants. Matches the SceneUniforms block in the shaders.
+struct SceneUniforms {
+    glm::mat4 View;
+    glm::mat4 Projection;
+    glm::mat4 InverseProjection;
+
+    // The size of the rendered region in pixels in xy.
+    glm::vec4 ViewportSize;
+
+    // The near plane, the far plane and log(far / near).
+    glm::vec4 DepthRange;
+
+    // The number of lights in x.
+    glm::uvec4 LightCount;
+
+    static SceneUniforms Build(glm::vec3 const &cameraPosition, glm::vec3 const &cameraTarget, vk::Extent2D const &extent);
+};
+
+struct LightingSettings {
+    uint32_t LightCount = 1024;
+
+    // Reads --lights= from the command line.
+    static LightingSettings Parse(int argc, char **argv);
+};
+
+// Bins lights into a froxel grid with a compute pass each frame, so that the forward pass only has to shade the
+// lights that can reach a fragment's cluster. Every frame in flight has its own set of buffers.
+class ClusteredLighting {
+public:
+    ClusteredLighting(
+        MemoryTelemetry &telemetry,
+        vk::Device const &device,
+        uint32_t frameCount,
+        uint32_t maxLights
+    );
+
+    // The layout of the scene descriptor set shared by the culling and forward passes.
+    vk::DescriptorSetLayout SetLayout() const { return *setLayout; }
+
+    vk::DescriptorSet DescriptorSet(uint32_t frame) const { return frames[frame].Set; }
+
+    // Uploads the frame's constants and lights, which are moved from world into view space on the way. The frame's
+    // previous work must have completed.
+    void Update(uint32_t frame, SceneUniforms uniforms, std::vector<Light> const &lights);
+
+    // How often the frame's last culling pass found a light for a cluster that already held MaxLightsPerCluster
+    // lights, and had to leave it out. The frame's previous work must have completed.
+    uint32_t DroppedLights(uint32_t frame) const;
+
+    // Records the culling pass, leaving the cluster lists ready to be read by fragment shaders.
+    void RecordCulling(vk::CommandBuffer const &commandBuffer, uint32_t frame) const;
+
+private:
+    struct Frame {
+        Buffer Uniforms;
+        Buffer Lights;
+        Buffer ClusterRanges;
+        Buffer LightIndices;
+        Buffer Counter;
+        vk::DescriptorSet Set;
+    };
+
+    uint32_t maxLights;
+    vk::UniqueDescriptorSetLayout setLayout;
+    vk::UniqueDescriptorPool descriptorPool;
+    vk::UniquePipelineLayout pipelineLayout;
+    vk::UniquePipeline pipeline;
+    std::vector<Frame> frames;
+};
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstring>
+
+namespace py {
+// Returns the value of a "--name=value" argument, or nullptr if the argument is something else.
+inline char const *OptionValue(char const *argument, char const *name) {
+    size_t length = std::strlen(name);
+    if (std::strncmp(argument, name, length) != 0 || argument[length] != '=') {
+        return nullptr;
+    }
+    return argument + length + 1;
+}
+}
@@ -0,0 +1,167 @@
+#include "DebugMessageSink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace py {
+// How long the logger sleeps when there is nothing to drain. Producers never wake it up, as that could block them.
+static constexpr std::chrono::milliseconds IdleInterval { 5 };
+
+template <size_t Size>
+static void CopyTruncated(std::array<char, Size>& destination, char const* source) {
+	if (source == nullptr) {
+		destination[0] = '\0';
+		return;
+	}
+
+	size_t length = std::min(std::strlen(source), Size - 1);
+	std::memcpy(destination.data(), source, length);
+	destination[length] = '\0';
+}
+
+static size_t RoundUpToPowerOfTwo(size_t value) {
+	size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+DebugMessageSink::DebugMessageSink(size_t capacity) {
+	size_t size = RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2));
+	slots = std::make_unique<Slot[]>(size);
+	mask = size - 1;
+	for (size_t i = 0; i < size; ++i) {
+		slots[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	logger = std::thread(&DebugMessageSink::Run, this);
+}
+
+DebugMessageSink::~DebugMessageSink() {
+	running.store(false, std::memory_order_release);
+	logger.join();
+
+	for (auto const& [id, counter] : counters) {
+		if (counter.Count > 1) {
+			std::cerr << "[Vulkan Debug] " << counter.MessageIdName << " (" << id << ") was reported "
+				<< counter.Count << " times\n";
+		}
+	}
+	if (uint64_t droppedCount = DroppedCount()) {
+		std::cerr << "[Vulkan Debug] " << droppedCount << " messages were dropped\n";
+	}
+}
+
+void DebugMessageSink::Push(
+	VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+	VkDebugUtilsMessageTypeFlagsEXT type,
+	VkDebugUtilsMessengerCallbackDataEXT const* callbackData
+) {
+	// Claim a slot. This is the producer half of a bounded multi-producer queue, each slot's sequence tells whether
+	// it is free for the given position.
+	size_t position = enqueuePosition.load(std::memory_order_relaxed);
+	Slot* slot;
+	for (;;) {
+		slot = &slots[position & mask];
+		size_t sequence = slot->Sequence.load(std::memory_order_acquire);
+		intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+		if (difference == 0) {
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// The logger hasn't caught up with the slot yet, so the buffer is full.
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	Entry& entry = slot->Value;
+	entry.MessageId = callbackData->messageIdNumber;
+	entry.Severity = severity;
+	entry.Type = type;
+	CopyTruncated(entry.MessageIdName, callbackData->pMessageIdName);
+	CopyTruncated(entry.Message, callbackData->pMessage);
+	slot->Sequence.store(position + 1, std::memory_order_release);
+}
+
+bool DebugMessageSink::Pop(Entry& entry) {
+	Slot& slot = slots[dequeuePosition & mask];
+	size_t sequence = slot.Sequence.load(std::memory_order_acquire);
+	if (sequence != dequeuePosition + 1) {
+		return false;
+	}
+
+	entry = slot.Value;
+	slot.Sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+	dequeuePosition++;
+	return true;
+}
+
+void DebugMessageSink::Record(Entry const& entry) {
+	bool firstOccurrence;
+	{
+		std::lock_guard<std::mutex> lock(countersMutex);
+		auto [counter, inserted] = counters.try_emplace(entry.MessageId, DebugMessageCounter {
+			entry.MessageId,
+			entry.MessageIdName.data(),
+			static_cast<vk::DebugUtilsMessageSeverityFlagBitsEXT>(entry.Severity),
+			vk::DebugUtilsMessageTypeFlagsEXT(entry.Type),
+			0
+		});
+		counter->second.Count++;
+		firstOccurrence = inserted;
+	}
+
+	// Messages without an ID (e.g. from the loader) can't be told apart, so all of them are printed.
+	if (firstOccurrence || entry.MessageId == 0) {
+		std::cerr << "[Vulkan Debug] " << entry.Message.data() << '\n';
+	}
+}
+
+void DebugMessageSink::Run() {
+	Entry entry;
+	for (;;) {
+		// Check whether to stop before draining, so that everything pushed before the request is still printed.
+		bool stopping = !running.load(std::memory_order_acquire);
+		bool drained = false;
+		while (Pop(entry)) {
+			Record(entry);
+			drained = true;
+		}
+
+		if (stopping) {
+			break;
+		}
+		if (!drained) {
+			std::this_thread::sleep_for(IdleInterval);
+		}
+	}
+}
+
+std::vector<DebugMessageCounter> DebugMessageSink::Counters() const {
+	std::lock_guard<std::mutex> lock(countersMutex);
+	std::vector<DebugMessageCounter> snapshot;
+	snapshot.reserve(counters.size());
+	for (auto const& [id, counter] : counters) {
+		snapshot.push_back(counter);
+	}
+	return snapshot;
+}
+
+uint64_t DebugMessageSink::CountOfType(vk::DebugUtilsMessageTypeFlagBitsEXT type) const {
+	std::lock_guard<std::mutex> lock(countersMutex);
+	uint64_t count = 0;
+	for (auto const& [id, counter] : counters) {
+		if (counter.Type & type) {
+			count += counter.Count;
+		}
+	}
+	return count;
+}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#define NOMINMAX
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace py {
+// How often a given debug message has been reported.
+struct DebugMessageCounter {
+    int32_t MessageId;
+    std::string MessageIdName;
+    vk::DebugUtilsMessageSeverityFlagBitsEXT Severity;
+    vk::DebugUtilsMessageTypeFlagsEXT Type;
+    uint64_t Count;
+};
+
+// Collects debug messenger reports without blocking the driver threads that raise them. Messages are pushed into a
+// lock-free ring buffer and drained by a background logger, which prints the first occurrence of each message ID
+// and counts the rest.
+class DebugMessageSink {
+public:
+    // The capacity is rounded up to a power of two.
+    explicit DebugMessageSink(size_t capacity = 1024);
+
+    // Drains any outstanding messages and prints a summary of the repeated ones.
+    ~DebugMessageSink();
+
+    DebugMessageSink(DebugMessageSink const &) = delete;
+    DebugMessageSink &operator=(DebugMessageSink const &) = delete;
+
+    // Safe to call from any thread. Never blocks or allocates; if the buffer is full the message is dropped.
+    void Push(
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+        VkDebugUtilsMessageTypeFlagsEXT type,
+        VkDebugUtilsMessengerCallbackDataEXT const *callbackData
+    );
+
+    // A snapshot of the counters of every message drained so far, ordered by message ID.
+    std::vector<DebugMessageCounter> Counters() const;
+
+    // The number of drained messages that were of the given type, e.g. performance warnings.
+    uint64_t CountOfType(vk::DebugUtilsMessageTypeFlagBitsEXT type) const;
+
+    // The number of messages that were lost because the buffer was full.
+    uint64_t DroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        int32_t MessageId;
+        VkDebugUtilsMessageSeverityFlagBitsEXT Severity;
+        VkDebugUtilsMessageTypeFlagsEXT Type;
+        std::array<char, 128> MessageIdName;
+        std::array<char, 1024> Message;
+    };
+
+    struct Slot {
+        std::atomic<size_t> Sequence;
+        Entry Value;
+    };
+
+    bool Pop(Entry &entry);
+    void Record(Entry const &entry);
+    void Run();
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    std::atomic<size_t> enqueuePosition { 0 };
+    size_t dequeuePosition = 0;
+    std::atomic<uint64_t> dropped { 0 };
+
+    mutable std::mutex countersMutex;
+    std::map<int32_t, DebugMessageCounter> counters;
+
+    std::atomic<bool> running { true };
+    std::thread logger;
+};
+}
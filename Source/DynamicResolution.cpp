@@ -0,0 +1,198 @@
+#include "DynamicResolution.hpp"
+
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace py {
+// Weight given to the newest GPU time when smoothing.
+static constexpr double GpuTimeSmoothing = 0.1;
+
+// How far the scale moves towards its ideal value per frame. Lower values trade reaction time for stability.
+static constexpr double ScaleResponse = 0.1;
+
+// Frame times within this fraction of the budget leave the scale alone, so that noise doesn't cause shimmering.
+static constexpr double BudgetTolerance = 0.05;
+
+RenderTarget RenderTarget::Build(
+	MemoryTelemetry& telemetry,
+	vk::Device const& device,
+	vk::RenderPass const& renderPass,
+	vk::Format format,
+	vk::Extent2D const& extent
+) {
+	RenderTarget target;
+	target.Extent = extent;
+
+	vk::ImageCreateInfo imageInfo {
+		{},
+		vk::ImageType::e2D,
+		format,
+		vk::Extent3D { extent.width, extent.height, 1 },
+		1,
+		1,
+		vk::SampleCountFlagBits::e1,
+		vk::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+		vk::SharingMode::eExclusive,
+		0, nullptr,
+		vk::ImageLayout::eUndefined
+	};
+	target.Image = device.createImageUnique(imageInfo);
+	target.Memory = AllocateMemory(
+		telemetry,
+		device,
+		device.getImageMemoryRequirements(*target.Image),
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		MemoryTag::RenderTargets
+	);
+	device.bindImageMemory(*target.Image, *target.Memory, 0);
+
+	target.View = BuildImageView(device, *target.Image, format);
+
+	vk::FramebufferCreateInfo framebufferInfo {
+		{},
+		renderPass,
+		1, &*target.View,
+		extent.width,
+		extent.height,
+		1
+	};
+	target.Framebuffer = device.createFramebufferUnique(framebufferInfo);
+	return target;
+}
+
+vk::Filter ChooseUpscaleFilter(vk::PhysicalDevice const& physicalDevice, vk::Format format) {
+	vk::FormatFeatureFlags features = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+	if (!(features & vk::FormatFeatureFlagBits::eBlitSrc) || !(features & vk::FormatFeatureFlagBits::eBlitDst)) {
+		throw std::runtime_error("swapchain format does not support blits");
+	}
+
+	if (features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) {
+		return vk::Filter::eLinear;
+	}
+	return vk::Filter::eNearest;
+}
+
+void RecordUpscale(
+	vk::CommandBuffer const& commandBuffer,
+	RenderTarget const& target,
+	vk::Extent2D const& renderExtent,
+	vk::Image const& swapchainImage,
+	vk::Extent2D const& swapchainExtent,
+	vk::Filter filter,
+	vk::ImageLayout finalLayout
+) {
+	vk::ImageSubresourceRange colorRange { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+	vk::ImageSubresourceLayers colorLayers { vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+
+	// The previous contents of the swapchain image are irrelevant, it is overwritten entirely.
+	vk::ImageMemoryBarrier toTransfer {
+		{},
+		vk::AccessFlagBits::eTransferWrite,
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eTransferDstOptimal,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED,
+		swapchainImage,
+		colorRange
+	};
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eTransfer,
+		{},
+		nullptr, nullptr, toTransfer
+	);
+
+	vk::ImageBlit region {
+		colorLayers,
+		{ vk::Offset3D { 0, 0, 0 }, vk::Offset3D {
+			static_cast<int32_t>(renderExtent.width),
+			static_cast<int32_t>(renderExtent.height),
+			1
+		} },
+		colorLayers,
+		{ vk::Offset3D { 0, 0, 0 }, vk::Offset3D {
+			static_cast<int32_t>(swapchainExtent.width),
+			static_cast<int32_t>(swapchainExtent.height),
+			1
+		} }
+	};
+	commandBuffer.blitImage(
+		*target.Image, vk::ImageLayout::eTransferSrcOptimal,
+		swapchainImage, vk::ImageLayout::eTransferDstOptimal,
+		region,
+		filter
+	);
+
+	vk::ImageMemoryBarrier toPresent {
+		vk::AccessFlagBits::eTransferWrite,
+		{},
+		vk::ImageLayout::eTransferDstOptimal,
+		finalLayout,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED,
+		swapchainImage,
+		colorRange
+	};
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eBottomOfPipe,
+		{},
+		nullptr, nullptr, toPresent
+	);
+}
+
+ResolutionScalerSettings ResolutionScalerSettings::Parse(int argc, char** argv) {
+	ResolutionScalerSettings settings;
+	for (int i = 1; i < argc; ++i) {
+		if (char const* value = OptionValue(argv[i], "--gpu-budget-ms")) {
+			settings.GpuBudgetMilliseconds = std::stod(value);
+			if (settings.GpuBudgetMilliseconds < 0.0) {
+				throw std::runtime_error("--gpu-budget-ms must not be negative");
+			}
+		} else if (char const* value = OptionValue(argv[i], "--min-render-scale")) {
+			settings.MinScale = std::stod(value);
+			if (settings.MinScale <= 0.0 || settings.MinScale > settings.MaxScale) {
+				throw std::runtime_error("--min-render-scale must be in (0, 1]");
+			}
+		}
+	}
+	return settings;
+}
+
+ResolutionScaler::ResolutionScaler(ResolutionScalerSettings const& settings)
+	: settings(settings), scale(settings.MaxScale) {}
+
+void ResolutionScaler::Update(double gpuSeconds) {
+	if (settings.GpuBudgetMilliseconds <= 0.0) {
+		return;
+	}
+
+	if (smoothedGpuSeconds == 0.0) {
+		smoothedGpuSeconds = gpuSeconds;
+	} else {
+		smoothedGpuSeconds += (gpuSeconds - smoothedGpuSeconds) * GpuTimeSmoothing;
+	}
+
+	double budgetSeconds = settings.GpuBudgetMilliseconds * 1e-3;
+	double ratio = budgetSeconds / std::max(smoothedGpuSeconds, 1e-6);
+	if (std::abs(ratio - 1.0) < BudgetTolerance) {
+		return;
+	}
+
+	// GPU time is roughly proportional to the number of pixels, which grows with the square of the scale.
+	double idealScale = std::clamp(scale * std::sqrt(ratio), settings.MinScale, settings.MaxScale);
+	scale += (idealScale - scale) * ScaleResponse;
+}
+
+vk::Extent2D ResolutionScaler::ScaledExtent(vk::Extent2D const& outputExtent) const {
+	return vk::Extent2D {
+		std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.width * scale))),
+		std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.height * scale)))
+	};
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+namespace py {
+// An offscreen color target the scene is rendered into before being scaled into the swapchain. It is allocated at
+// the full output size and only a region of it is rendered to, so changing the render resolution never has to
+// recreate anything.
+struct RenderTarget {
+    vk::UniqueImage Image;
+    DeviceMemory Memory;
+    vk::UniqueImageView View;
+    vk::UniqueFramebuffer Framebuffer;
+    vk::Extent2D Extent;
+
+    static RenderTarget Build(
+        MemoryTelemetry &telemetry,
+        vk::Device const &device,
+        vk::RenderPass const &renderPass,
+        vk::Format format,
+        vk::Extent2D const &extent
+    );
+};
+
+// Picks the filter used to scale render targets of the given format into the swapchain.
+vk::Filter ChooseUpscaleFilter(vk::PhysicalDevice const &physicalDevice, vk::Format format);
+
+// Scales the rendered region of the target into the swapchain image, leaving the image in the final layout, which
+// is ready to present by default. The target must be in the transfer source layout.
+void RecordUpscale(
+    vk::CommandBuffer const &commandBuffer,
+    RenderTarget const &target,
+    vk::Extent2D const &renderExtent,
+    vk::Image const &swapchainImage,
+    vk::Extent2D const &swapchainExtent,
+    vk::Filter filter,
+    vk::ImageLayout finalLayout = vk::ImageLayout::ePresentSrcKHR
+);
+
+struct ResolutionScalerSettings {
+    // 0 disables scaling and always renders at full resolution.
+    double GpuBudgetMilliseconds = 16.0;
+    double MinScale = 0.5;
+    double MaxScale = 1.0;
+
+    // Reads --gpu-budget-ms= and --min-render-scale= from the command line.
+    static ResolutionScalerSettings Parse(int argc, char **argv);
+};
+
+// Steers the render resolution so that the measured GPU frame time settles at the budget.
+class ResolutionScaler {
+public:
+    explicit ResolutionScaler(ResolutionScalerSettings const &settings);
+
+    // Feeds in the GPU time of a completed frame.
+    void Update(double gpuSeconds);
+
+    // The fraction of the output resolution to render at along each axis.
+    double Scale() const { return scale; }
+
+    vk::Extent2D ScaledExtent(vk::Extent2D const &outputExtent) const;
+
+private:
+    ResolutionScalerSettings settings;
+    double scale;
+    double smoothedGpuSeconds = 0.0;
+};
+}
@@ -0,0 +1,123 @@
+#include "FramePacing.hpp"
+
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace py {
+// Weight given to the newest sample when smoothing the measured GPU slack.
+static constexpr double SlackSmoothing = 0.1;
+
+// Portion of the measured slack we don't delay by, so that a slightly slower frame doesn't starve the GPU.
+static constexpr double SlackSafetyMargin = 0.001;
+
+// Sleeping is coarse on some platforms, so the last stretch before a deadline is spent yielding instead.
+static constexpr std::chrono::microseconds SpinThreshold { 1000 };
+
+static vk::PresentModeKHR ParsePresentMode(std::string const& name) {
+	if (name == "immediate") {
+		return vk::PresentModeKHR::eImmediate;
+	}
+	if (name == "mailbox") {
+		return vk::PresentModeKHR::eMailbox;
+	}
+	if (name == "fifo") {
+		return vk::PresentModeKHR::eFifo;
+	}
+	if (name == "fifo-relaxed") {
+		return vk::PresentModeKHR::eFifoRelaxed;
+	}
+	throw std::runtime_error("unknown present mode: " + name);
+}
+
+FramePacingSettings FramePacingSettings::Parse(int argc, char** argv) {
+	FramePacingSettings settings;
+	for (int i = 1; i < argc; ++i) {
+		char const* argument = argv[i];
+		if (char const* value = OptionValue(argument, "--present-mode")) {
+			settings.PresentMode = ParsePresentMode(value);
+		} else if (char const* value = OptionValue(argument, "--frames-in-flight")) {
+			int framesInFlight = std::stoi(value);
+			if (framesInFlight < 1) {
+				throw std::runtime_error("--frames-in-flight must be at least 1");
+			}
+			settings.MaxFramesInFlight = static_cast<uint32_t>(framesInFlight);
+		} else if (std::strcmp(argument, "--low-latency") == 0) {
+			settings.LowLatency = true;
+		} else if (char const* value = OptionValue(argument, "--target-fps")) {
+			settings.TargetFps = std::stod(value);
+			if (settings.TargetFps < 0.0) {
+				throw std::runtime_error("--target-fps must not be negative");
+			}
+		}
+	}
+	return settings;
+}
+
+uint32_t FramePacingSettings::SwapchainImageCount() const {
+	// One more image than frames in flight, so there is always one to present from.
+	return MaxFramesInFlight == 0 ? 0 : MaxFramesInFlight + 1;
+}
+
+size_t FramePacingSettings::FramesInFlight(size_t swapchainImageCount) const {
+	// The surface may give us fewer images than SwapchainImageCount() asked for, so the one being presented is kept
+	// out of the count either way.
+	size_t available = swapchainImageCount > 1 ? swapchainImageCount - 1 : 1;
+	if (MaxFramesInFlight == 0) {
+		return available;
+	}
+	return std::min<size_t>(MaxFramesInFlight, available);
+}
+
+static void SleepUntil(FramePacer::Clock::time_point deadline) {
+	FramePacer::Clock::time_point now = FramePacer::Clock::now();
+	if (deadline - now > SpinThreshold) {
+		std::this_thread::sleep_until(deadline - SpinThreshold);
+	}
+	while (FramePacer::Clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+}
+
+FramePacer::FramePacer(FramePacingSettings const& settings) : settings(settings) {
+	if (settings.TargetFps > 0.0) {
+		frameInterval = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(1.0 / settings.TargetFps)
+		);
+	}
+}
+
+void FramePacer::BeginFrame() {
+	Clock::time_point start = Clock::now();
+	if (frameInterval > Clock::duration::zero() && lastFrameStart != Clock::time_point {}) {
+		Clock::time_point deadline = lastFrameStart + frameInterval;
+		if (start < deadline) {
+			SleepUntil(deadline);
+			start = deadline;
+		}
+	}
+	lastFrameStart = start;
+
+	if (latencyDelay > Clock::duration::zero()) {
+		SleepUntil(start + latencyDelay);
+	}
+}
+
+void FramePacer::ReportGpuWait(Clock::duration waited) {
+	if (!settings.LowLatency) {
+		return;
+	}
+
+	// The slack is what we already delayed by plus whatever we still ended up waiting. Smoothing the sum rather
+	// than the wait keeps the delay from oscillating once it starts absorbing the wait.
+	double slack = std::chrono::duration<double>(latencyDelay + waited).count();
+	gpuSlackSeconds += (slack - gpuSlackSeconds) * SlackSmoothing;
+
+	double delay = std::max(0.0, gpuSlackSeconds - SlackSafetyMargin);
+	latencyDelay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delay));
+}
+}
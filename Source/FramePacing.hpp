@@ -0,0 +1,60 @@
+#pragma once
+
+#define NOMINMAX
+#include <vulkan/vulkan.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+namespace py {
+// How frames are queued up and presented. Interactive use wants low latency, batch use wants throughput.
+struct FramePacingSettings {
+    // Falls back to FIFO when the surface doesn't support the requested mode.
+    vk::PresentModeKHR PresentMode = vk::PresentModeKHR::eMailbox;
+
+    // 0 keeps one frame in flight per swapchain image, minus the one being presented.
+    uint32_t MaxFramesInFlight = 0;
+
+    // Delays the start of each frame by however long the CPU would otherwise end up waiting on the GPU.
+    bool LowLatency = false;
+
+    // 0 leaves the frame rate unlimited.
+    double TargetFps = 0.0;
+
+    // Reads --present-mode=, --frames-in-flight=, --low-latency and --target-fps= from the command line.
+    static FramePacingSettings Parse(int argc, char **argv);
+
+    // The number of swapchain images to ask for, or 0 to let the swapchain decide.
+    uint32_t SwapchainImageCount() const;
+
+    // The number of frames in flight to use with a swapchain of the given size.
+    size_t FramesInFlight(size_t swapchainImageCount) const;
+};
+
+// Decides when the CPU should start on the next frame.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FramePacer(FramePacingSettings const &settings);
+
+    // Blocks until the next frame should start. Call this before sampling input.
+    void BeginFrame();
+
+    // Reports how long the CPU was blocked waiting for the GPU, both for the frame's resources to be released and
+    // for a swapchain image to be acquired.
+    void ReportGpuWait(Clock::duration waited);
+
+    // The delay currently applied at the start of each frame by the low latency mode.
+    Clock::duration LatencyDelay() const { return latencyDelay; }
+
+private:
+    FramePacingSettings settings;
+    Clock::duration frameInterval {};
+    Clock::time_point lastFrameStart {};
+
+    // Smoothed estimate of how much of each frame the CPU would spend waiting on the GPU.
+    double gpuSlackSeconds = 0.0;
+    Clock::duration latencyDelay {};
+};
+}
@@ -0,0 +1,58 @@
+#include "GpuTimer.hpp"
+
+#include <array>
+
+namespace py {
+GpuTimer::GpuTimer(PhysicalDeviceDetails const& physicalDevice, vk::Device const& device, uint32_t slotCount)
+	: device(device), recorded(slotCount, false) {
+	uint32_t validBits = physicalDevice.QueueFamilies[physicalDevice.GraphicsFamilyIndex.value()].timestampValidBits;
+	if (validBits == 0) {
+		return;
+	}
+
+	validBitsMask = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+	secondsPerTick = physicalDevice.Properties.limits.timestampPeriod * 1e-9;
+	queryPool = device.createQueryPoolUnique({ {}, vk::QueryType::eTimestamp, slotCount * 2 });
+}
+
+void GpuTimer::Begin(vk::CommandBuffer const& commandBuffer, uint32_t slot) {
+	if (!queryPool) {
+		return;
+	}
+
+	commandBuffer.resetQueryPool(*queryPool, slot * 2, 2);
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *queryPool, slot * 2);
+}
+
+void GpuTimer::End(vk::CommandBuffer const& commandBuffer, uint32_t slot) {
+	if (!queryPool) {
+		return;
+	}
+
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *queryPool, slot * 2 + 1);
+	recorded[slot] = true;
+}
+
+std::optional<double> GpuTimer::Read(uint32_t slot) {
+	if (!queryPool || !recorded[slot]) {
+		return std::nullopt;
+	}
+	recorded[slot] = false;
+
+	std::array<uint64_t, 2> timestamps {};
+	vk::Result result = device.getQueryPoolResults(
+		*queryPool,
+		slot * 2, 2,
+		sizeof(timestamps), timestamps.data(),
+		sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64
+	);
+	if (result != vk::Result::eSuccess) {
+		// The caller is expected to have waited on the work already, but don't block if it hasn't.
+		return std::nullopt;
+	}
+
+	uint64_t ticks = ((timestamps[1] & validBitsMask) - (timestamps[0] & validBitsMask)) & validBitsMask;
+	return static_cast<double>(ticks) * secondsPerTick;
+}
+}
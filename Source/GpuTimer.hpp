@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace py {
+// Measures the GPU time between two points in a command buffer with timestamp queries. Each frame in flight gets
+// its own slot so that reading one frame's result never waits on another.
+class GpuTimer {
+public:
+    GpuTimer(PhysicalDeviceDetails const &physicalDevice, vk::Device const &device, uint32_t slotCount);
+
+    // Whether the graphics queue supports timestamps at all. If not, Read() never returns a value.
+    bool IsSupported() const { return static_cast<bool>(queryPool); }
+
+    void Begin(vk::CommandBuffer const &commandBuffer, uint32_t slot);
+    void End(vk::CommandBuffer const &commandBuffer, uint32_t slot);
+
+    // Returns the seconds spent between Begin() and End() for the slot, once the work recorded for it has
+    // completed on the GPU. Returns nothing if the slot hasn't been recorded since it was last read.
+    std::optional<double> Read(uint32_t slot);
+
+private:
+    vk::Device device;
+    vk::UniqueQueryPool queryPool;
+    double secondsPerTick = 0.0;
+    uint64_t validBitsMask = 0;
+    std::vector<bool> recorded;
+};
+}
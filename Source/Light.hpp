@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace py {
+// A point or spot light in world space. Matches the layout of the Light struct in the lighting shaders, which receive
+// it in view space.
+struct Light {
+    // The world position in xyz and the range past which the light has no effect in w.
+    glm::vec4 PositionRange;
+
+    // The color in rgb, premultiplied by the intensity.
+    glm::vec4 Color;
+
+    // The spot direction in xyz and the cosine of the cone's half angle in w. Point lights use a w of -1.
+    glm::vec4 DirectionCosCone;
+};
+}
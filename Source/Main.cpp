@@ -7,23 +7,26 @@
 #undef max
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <vector>
 #include <utility>
 
+#include "ClusteredLighting.hpp"
+#include "DebugMessageSink.hpp"
+#include "DynamicResolution.hpp"
+#include "FramePacing.hpp"
+#include "GpuTimer.hpp"
+#include "MemoryTelemetry.hpp"
+#include "ParticleSystem.hpp"
+#include "Scene.hpp"
+#include "Simulation.hpp"
+#include "Trace.hpp"
 #include "Vulkan.hpp"
 
-static std::vector<uint32_t> const VertexShaderIL {
-	#include "Shaders/Triangle.vert.spv"
-};
-
-static std::vector<uint32_t> const FragmentShaderIL {
-	#include "Shaders/Triangle.frag.spv"
-};
-
 static GLFWwindow* BuildWindow(vk::Extent2D const& extent) {
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
@@ -57,164 +60,19 @@ static std::vector<std::string> RequiredVulkanExtensionsForGlfw() {
 	return std::vector<std::string>(extensions, extensions + numGlfwExtensions);
 }
 
-static vk::UniqueRenderPass BuildRenderPass(vk::Device const& device, vk::Format const& format) {
-	vk::AttachmentDescription colorAttachment {
-		{},
-		format,
-		vk::SampleCountFlagBits::e1,
-		vk::AttachmentLoadOp::eClear,
-		vk::AttachmentStoreOp::eStore,
-		vk::AttachmentLoadOp::eDontCare,
-		vk::AttachmentStoreOp::eDontCare,
-		vk::ImageLayout::eUndefined,
-		vk::ImageLayout::ePresentSrcKHR
-	};
-	vk::AttachmentReference colorAttachementRef {
-		0,
-		vk::ImageLayout::eColorAttachmentOptimal
-	};
-
-	vk::SubpassDescription subpass {
-		{},
-		vk::PipelineBindPoint::eGraphics,
-		0, nullptr,
-		1, &colorAttachementRef
-	};
-
-	vk::SubpassDependency dependency {
-		VK_SUBPASS_EXTERNAL,
-		0,
-		vk::PipelineStageFlagBits::eColorAttachmentOutput,
-		vk::PipelineStageFlagBits::eColorAttachmentOutput,
-		{},
-		vk::AccessFlagBits::eColorAttachmentWrite
-	};
-
-	vk::RenderPassCreateInfo renderPassInfo {
-		{},
-		1, &colorAttachment,
-		1, &subpass,
-		1, &dependency
-	};
-	return device.createRenderPassUnique(renderPassInfo);
-}
-
-static vk::UniquePipeline BuildGraphicsPipeline(
-	vk::Device const& device,
-	vk::Extent2D const& extent,
-	vk::PipelineLayout const& pipelineLayout,
-	vk::RenderPass const& renderPass
-) {
-	vk::UniqueShaderModule vertexShaderModule = py::BuildShaderModule(device, VertexShaderIL);
-	vk::UniqueShaderModule fragmentShaderModule = py::BuildShaderModule(device, FragmentShaderIL);
-	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages {
-		vk::PipelineShaderStageCreateInfo {
-			{},
-			vk::ShaderStageFlagBits::eVertex,
-			*vertexShaderModule,
-			"main"
-		},
-		vk::PipelineShaderStageCreateInfo {
-			{},
-			vk::ShaderStageFlagBits::eFragment,
-			*fragmentShaderModule,
-			"main"
-		}
-	};
-
-	// TODO: For now, the defaults are fine as the vertex data is coming from the shader itself.
-	vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
-
-	vk::PipelineInputAssemblyStateCreateInfo assemblyInputInfo {
-		{},
-		vk::PrimitiveTopology::eTriangleList,
-		false
-	};
-
-	vk::Viewport viewport {
-		0.0f,
-		0.0f,
-		static_cast<float>(extent.width),
-		static_cast<float>(extent.height),
-		0.0f,
-		1.0f
-	};
-	vk::Rect2D scissor {
-		{ 0, 0 },
-		extent
-	};
-	vk::PipelineViewportStateCreateInfo viewportStateInfo {
-		{},
-		1, &viewport,
-		1, &scissor
-	};
-
-	vk::PipelineRasterizationStateCreateInfo rasterizerInfo {
-		{},
-		false,
-		false,
-		vk::PolygonMode::eFill,
-		vk::CullModeFlagBits::eBack,
-		vk::FrontFace::eClockwise,
-		false,
-		0.0f,
-		0.0f,
-		0.0f,
-		1.0f
-	};
-
-	vk::PipelineMultisampleStateCreateInfo multisamplingInfo {
-		{},
-		vk::SampleCountFlagBits::e1,
-		false,
-		1.0f,
-		nullptr,
-		false,
-		false
-	};
-
-	vk::PipelineColorBlendAttachmentState colorBlendAttachment {
-		false,
-		vk::BlendFactor::eOne,
-		vk::BlendFactor::eZero,
-		vk::BlendOp::eAdd,
-		vk::BlendFactor::eOne,
-		vk::BlendFactor::eZero,
-		vk::BlendOp::eAdd,
-		vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-		vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
-	};
-	vk::PipelineColorBlendStateCreateInfo colorBlendInfo {
-		{},
-		false,
-		vk::LogicOp::eCopy,
-		1, &colorBlendAttachment
-	};
-
-	vk::GraphicsPipelineCreateInfo pipelineInfo {
-		{},
-		static_cast<uint32_t>(shaderStages.size()), shaderStages.data(),
-		&vertexInputInfo,
-		&assemblyInputInfo,
-		nullptr,
-		&viewportStateInfo,
-		&rasterizerInfo,
-		&multisamplingInfo,
-		nullptr,
-		&colorBlendInfo,
-		nullptr,
-		pipelineLayout,
-		renderPass,
-		0
-	};
-	return device.createGraphicsPipelineUnique({}, pipelineInfo);
-}
-
 using namespace py;
 
 int main(int argc, char** argv) {
 	int result = EXIT_SUCCESS;
 	try {
+		FramePacingSettings pacingSettings = FramePacingSettings::Parse(argc, argv);
+		ResolutionScalerSettings scalerSettings = ResolutionScalerSettings::Parse(argc, argv);
+		LightingSettings lightingSettings = LightingSettings::Parse(argc, argv);
+		ParticleSettings particleSettings = ParticleSettings::Parse(argc, argv);
+		MemoryTelemetrySettings memorySettings = MemoryTelemetrySettings::Parse(argc, argv);
+		TraceSettings traceSettings = TraceSettings::Parse(argc, argv);
+		TraceWriter trace(traceSettings.CapturePath);
+
 		if (!glfwInit()) {
 			throw std::runtime_error("glfwInit() failed");
 		}
@@ -229,14 +87,24 @@ int main(int argc, char** argv) {
 		InitializeDefaultDispatcher();
 		vk::ApplicationInfo appInfo = BuildApplicationInfo(VK_API_VERSION_1_1);
 		std::vector<std::string> instanceExtensions = RequiredVulkanExtensionsForGlfw();
+		// Must outlive the instance, which reports to it until it is destroyed. Only built when debugging, as its logger
+		// thread would otherwise run for nothing.
+		std::optional<DebugMessageSink> debugSink;
 #ifdef NDEBUG
-		vk::UniqueInstance instance = BuildVulkanInstance(appInfo, extensions, {}, false);
+		vk::UniqueInstance instance = InitializeVulkan(appInfo, instanceExtensions, {}, false, nullptr);
 		vk::UniqueDebugUtilsMessengerEXT debugMessenger;
 #else
+		debugSink.emplace();
 		instanceExtensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-		vk::UniqueInstance instance = InitializeVulkan(appInfo, instanceExtensions, { "VK_LAYER_KHRONOS_validation" }, true);
+		vk::UniqueInstance instance = InitializeVulkan(
+			appInfo,
+			instanceExtensions,
+			{ "VK_LAYER_KHRONOS_validation" },
+			true,
+			&*debugSink
+		);
 		vk::UniqueDebugUtilsMessengerEXT debugMessenger =
-			instance->createDebugUtilsMessengerEXTUnique(BuildDebugMessengerCreateInfo());
+			instance->createDebugUtilsMessengerEXTUnique(BuildDebugMessengerCreateInfo(&*debugSink));
 #endif
 
 		vk::UniqueSurfaceKHR surface = CreateWindowSurface(*instance, window);
@@ -245,6 +113,9 @@ int main(int argc, char** argv) {
 		std::unordered_set<uint32_t> queueFamilyIndexes =
 			{ physicalDeviceDetails.GraphicsFamilyIndex.value(), physicalDeviceDetails.PresentFamilyIndex.value() };
 		std::vector<std::string> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		if (physicalDeviceDetails.HasMemoryBudget) {
+			deviceExtensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
 #ifdef NDEBUG
 		vk::UniqueDevice device = BuildDevice(physicalDeviceDetails.Device, queueFamilyIndexes, deviceExtensions, {}, false);
 #else
@@ -259,9 +130,44 @@ int main(int argc, char** argv) {
 
 		vk::Queue graphicsQueue = device->getQueue(physicalDeviceDetails.GraphicsFamilyIndex.value(), 0);
 		vk::Queue presentQueue = device->getQueue(physicalDeviceDetails.PresentFamilyIndex.value(), 0);
-		vk::UniqueCommandPool commandPool = device->createCommandPoolUnique(
-			{ {}, physicalDeviceDetails.GraphicsFamilyIndex.value() }
+		vk::UniqueCommandPool commandPool = device->createCommandPoolUnique({
+			vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+			physicalDeviceDetails.GraphicsFamilyIndex.value()
+		});
+
+		// Must outlive every allocation, which reports to it when freed.
+		MemoryTelemetry memoryTelemetry(physicalDeviceDetails.Device, physicalDeviceDetails.HasMemoryBudget);
+		uint32_t pressuredHeaps = 0;
+		uint32_t previouslyPressuredHeaps = 0;
+		memoryTelemetry.AddPressureCallback(memorySettings.PressureThreshold,
+			[&](uint32_t heapIndex, HeapUsage const& heap, vk::DeviceSize excess) {
+				uint32_t heapBit = 1u << heapIndex;
+				pressuredHeaps |= heapBit;
+				if ((previouslyPressuredHeaps & heapBit) == 0) {
+					std::cerr << "[Memory] Heap " << heapIndex << " is " << excess << " bytes over the pressure threshold ("
+						<< heap.Usage << " of " << heap.Budget << " bytes used)" << std::endl;
+				}
+			}
 		);
+		FramePacer::Clock::time_point lastMemoryReport = FramePacer::Clock::now();
+
+		// The world is stepped on its own thread so that blocking on the swapchain or on in-flight fences never
+		// stalls it. Frames are recorded from whatever snapshot it has published most recently.
+		Simulation simulation(std::chrono::microseconds(8333), lightingSettings.LightCount);
+		simulation.Start();
+
+		FramePacer pacer(pacingSettings);
+		ResolutionScaler resolutionScaler(scalerSettings);
+
+		// Particle state lives on the GPU for the whole run, independent of the swapchain.
+		ParticleSystem particles(memoryTelemetry, *device, particleSettings);
+		trace.CreateParticleSystem({ particleSettings.Capacity, particleSettings.EmitRate });
+		double lastSimulationTime = 0.0;
+		double particleGpuSeconds = 0.0;
+		uint32_t particleGpuSamples = 0;
+		FramePacer::Clock::time_point lastParticleReport = FramePacer::Clock::now();
+		uint64_t droppedLights = 0;
+		FramePacer::Clock::time_point lastLightingReport = FramePacer::Clock::now();
 
 		// The previous swapchain is used when initializing the next one, which is why it exists
 		// outside of the loop.
@@ -283,49 +189,22 @@ int main(int argc, char** argv) {
 				static_cast<uint32_t>(windowHeight)
 			};
 
-			swapchainDetails.Initialize(windowExtent, *surface, physicalDeviceDetails, *device);
-
-			vk::UniquePipelineLayout pipelineLayout = device->createPipelineLayoutUnique({});
-			vk::UniqueRenderPass renderPass = BuildRenderPass(*device, swapchainDetails.Format);
-			vk::UniquePipeline graphicsPipeline =
-				BuildGraphicsPipeline(*device, swapchainDetails.Extent, *pipelineLayout, *renderPass);
-
-			std::vector<vk::UniqueFramebuffer> framebuffers = swapchainDetails.BuildFramebuffers(*device, *renderPass);
-			std::vector<vk::UniqueCommandBuffer> commandBuffers = device->allocateCommandBuffersUnique(
-				{ *commandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(framebuffers.size()) }
+			swapchainDetails.Initialize(
+				windowExtent,
+				*surface,
+				physicalDeviceDetails,
+				*device,
+				pacingSettings.PresentMode,
+				pacingSettings.SwapchainImageCount()
 			);
 
-			size_t numBuffers = std::min(framebuffers.size(), commandBuffers.size());
-			for (size_t bufferIndex = 0; bufferIndex < numBuffers; ++bufferIndex) {
-				vk::Framebuffer& framebuffer = *framebuffers[bufferIndex];
-				vk::CommandBuffer& commandBuffer = *commandBuffers[bufferIndex];
-
-				commandBuffer.begin(vk::CommandBufferBeginInfo {});
-
-				vk::ClearValue clearValue = vk::ClearColorValue(
-					std::array<float, 4> { 0.0f, 0.0f, 0.0f, 1.0f }
-				);
-				vk::RenderPassBeginInfo renderPassBegin {
-					*renderPass,
-					framebuffer,
-					vk::Rect2D { { 0, 0 }, swapchainDetails.Extent },
-					1, &clearValue
-				};
-				commandBuffer.beginRenderPass(renderPassBegin, vk::SubpassContents::eInline);
-
-				commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *graphicsPipeline);
-				commandBuffer.draw(3, 1, 0, 0);
-				commandBuffer.endRenderPass();
-				commandBuffer.end();
-			}
-
 			// TODO: Might be able to break this out into a separate object.
 			std::vector<vk::UniqueSemaphore> availableImageSemaphores;
 			std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
 			std::vector<vk::UniqueFence> inFlightFences;
 			std::vector<vk::Fence> imagesInFlight(swapchainDetails.Images.size());
 
-			size_t maxInFlightImages = swapchainDetails.Images.size() - 1;
+			size_t maxInFlightImages = pacingSettings.FramesInFlight(swapchainDetails.Images.size());
 			availableImageSemaphores.reserve(maxInFlightImages);
 			renderFinishedSemaphores.reserve(maxInFlightImages);
 			inFlightFences.reserve(maxInFlightImages);
@@ -336,24 +215,109 @@ int main(int argc, char** argv) {
 				inFlightFences.emplace_back(device->createFenceUnique({ vk::FenceCreateFlagBits::eSignaled }));
 			}
 
+			ClusteredLighting lighting(
+				memoryTelemetry,
+				*device,
+				static_cast<uint32_t>(maxInFlightImages),
+				lightingSettings.LightCount
+			);
+			ScenePipelines scene =
+				ScenePipelines::Build(*device, swapchainDetails.Format, lighting.SetLayout(), particles.SetLayout());
+
+			// Command buffers are re-recorded every frame, so one per frame in flight is enough.
+			std::vector<vk::UniqueCommandBuffer> commandBuffers = device->allocateCommandBuffersUnique(
+				{ *commandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(maxInFlightImages) }
+			);
+
+			// Each frame in flight renders into its own target, as the previous frame may still be reading from
+			// its target while the next one is rendered.
+			std::vector<RenderTarget> renderTargets;
+			renderTargets.reserve(maxInFlightImages);
+			for (size_t i = 0; i < maxInFlightImages; ++i) {
+				renderTargets.emplace_back(RenderTarget::Build(
+					memoryTelemetry,
+					*device,
+					*scene.RenderPass,
+					swapchainDetails.Format,
+					swapchainDetails.Extent
+				));
+			}
+
+			trace.CreateFrameResources({
+				swapchainDetails.Format,
+				swapchainDetails.Extent,
+				static_cast<uint32_t>(maxInFlightImages),
+				lightingSettings.LightCount
+			});
+
+			vk::Filter upscaleFilter = ChooseUpscaleFilter(physicalDeviceDetails.Device, swapchainDetails.Format);
+			GpuTimer frameTimer(physicalDeviceDetails, *device, static_cast<uint32_t>(maxInFlightImages));
+			GpuTimer particleTimer(physicalDeviceDetails, *device, static_cast<uint32_t>(maxInFlightImages));
+
 			size_t syncObjectIndex = 0;
 			bool validSwapchain = true;
 			while (!glfwWindowShouldClose(window) && validSwapchain) {
-				// Draw the next frame.
+				// Draw the next frame, sampling input only once the pacer lets us start on it.
+				pacer.BeginFrame();
 				glfwPollEvents();
 
-				syncObjectIndex = ++syncObjectIndex < maxInFlightImages ? syncObjectIndex : 0;
 				vk::Semaphore& availableImageSemaphore = *availableImageSemaphores[syncObjectIndex];
 				vk::Semaphore& renderFinishedSemaphore = *renderFinishedSemaphores[syncObjectIndex];
 				vk::Fence& inFlightFence = *inFlightFences[syncObjectIndex];
+				vk::CommandBuffer& commandBuffer = *commandBuffers[syncObjectIndex];
+				RenderTarget const& renderTarget = renderTargets[syncObjectIndex];
+				uint32_t frameSlot = static_cast<uint32_t>(syncObjectIndex);
 
+				FramePacer::Clock::time_point fenceWaitStart = FramePacer::Clock::now();
 				device->waitForFences(inFlightFence, true, std::numeric_limits<uint64_t>::max());
+				FramePacer::Clock::duration fenceWait = FramePacer::Clock::now() - fenceWaitStart;
+
+				if (std::optional<double> gpuSeconds = frameTimer.Read(frameSlot)) {
+					resolutionScaler.Update(*gpuSeconds);
+				}
+				if (std::optional<double> gpuSeconds = particleTimer.Read(frameSlot)) {
+					particleGpuSeconds += *gpuSeconds;
+					particleGpuSamples++;
+				}
+
+				if (particleSettings.ReportStats && FramePacer::Clock::now() - lastParticleReport > std::chrono::seconds(1)) {
+					if (particleGpuSamples > 0) {
+						std::cerr << "[Particles] " << particleSettings.Capacity << " capacity, "
+							<< particleGpuSeconds / particleGpuSamples * 1000.0 << " ms simulation" << std::endl;
+					}
+					particleGpuSeconds = 0.0;
+					particleGpuSamples = 0;
+					lastParticleReport = FramePacer::Clock::now();
+				}
 
+				// Lights past MaxLightsPerCluster pop in and out, so don't let that happen silently.
+				droppedLights += lighting.DroppedLights(frameSlot);
+				if (FramePacer::Clock::now() - lastLightingReport > std::chrono::seconds(1)) {
+					if (droppedLights > 0) {
+						std::cerr << "[Lighting] " << droppedLights << " lights left out of full clusters in the last second, "
+							<< "clusters hold at most " << MaxLightsPerCluster << " lights" << std::endl;
+					}
+					droppedLights = 0;
+					lastLightingReport = FramePacer::Clock::now();
+				}
+
+				// Pressure is only reported when a heap first crosses the threshold, not on every frame it stays above.
+				previouslyPressuredHeaps = pressuredHeaps;
+				pressuredHeaps = 0;
+				memoryTelemetry.Update();
+				if (memorySettings.ReportStats && FramePacer::Clock::now() - lastMemoryReport > std::chrono::seconds(1)) {
+					memoryTelemetry.Print(std::cerr);
+					lastMemoryReport = FramePacer::Clock::now();
+				}
+
+				// Under FIFO most of the blocking happens here rather than on the fence, so the pacer is told about both.
+				FramePacer::Clock::time_point acquireStart = FramePacer::Clock::now();
 				vk::ResultValue<uint32_t> imageIndexResult = device->acquireNextImageKHR(
 					*swapchainDetails.Swapchain,
 					std::numeric_limits<uint64_t>::max(),
 					availableImageSemaphore, {}
 				);
+				pacer.ReportGpuWait(fenceWait + (FramePacer::Clock::now() - acquireStart));
 
 				switch (imageIndexResult.result) {
 				case vk::Result::eSuccess:
@@ -366,7 +330,7 @@ int main(int argc, char** argv) {
 					throw std::runtime_error("Failed to acquire next image from swapchain");
 				}
 
-				syncObjectIndex++;
+				syncObjectIndex = (syncObjectIndex + 1) % maxInFlightImages;
 				uint32_t imageIndex = imageIndexResult.value;
 
 				vk::Fence& imageInFlight = imagesInFlight[imageIndex];
@@ -375,15 +339,61 @@ int main(int argc, char** argv) {
 				}
 				imageInFlight = inFlightFence;
 
-				vk::PipelineStageFlags waitStages { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+				// Take the latest snapshot as late as possible, the simulation keeps running while we were blocked.
+				FrameState const& frameState = simulation.Latest();
+				vk::Extent2D renderExtent = resolutionScaler.ScaledExtent(swapchainDetails.Extent);
+				trace.BeginFrame({ frameSlot });
+				SceneUniforms sceneUniforms =
+					SceneUniforms::Build(frameState.CameraPosition, frameState.CameraTarget, renderExtent);
+				lighting.Update(frameSlot, sceneUniforms, frameState.Lights);
+				trace.UploadLighting(sceneUniforms, frameState.Lights);
+
+				commandBuffer.reset({});
+				commandBuffer.begin(vk::CommandBufferBeginInfo { vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+				frameTimer.Begin(commandBuffer, frameSlot);
+				lighting.RecordCulling(commandBuffer, frameSlot);
+				trace.CullLights();
+
+				// Simulation time only moves forward, but the same snapshot may be rendered more than once.
+				float deltaTime = static_cast<float>(std::min(frameState.Time - lastSimulationTime, 0.1));
+				lastSimulationTime = frameState.Time;
+				particleTimer.Begin(commandBuffer, frameSlot);
+				particles.RecordSimulation(commandBuffer, deltaTime, static_cast<float>(frameState.Time));
+				particleTimer.End(commandBuffer, frameSlot);
+				trace.SimulateParticles({ deltaTime, static_cast<float>(frameState.Time) });
+
+				RecordSceneCommands(
+					commandBuffer,
+					scene,
+					*renderTarget.Framebuffer,
+					renderExtent,
+					lighting.DescriptorSet(frameSlot),
+					particles,
+					frameState.Rotation
+				);
+				trace.DrawScene({ renderExtent, frameState.Rotation });
+				RecordUpscale(
+					commandBuffer,
+					renderTarget,
+					renderExtent,
+					swapchainDetails.Images[imageIndex],
+					swapchainDetails.Extent,
+					upscaleFilter
+				);
+				frameTimer.End(commandBuffer, frameSlot);
+				commandBuffer.end();
+
+				// Only the upscale touches the swapchain image.
+				vk::PipelineStageFlags waitStages { vk::PipelineStageFlagBits::eTransfer };
 				vk::SubmitInfo submitInfo {
 					1, &availableImageSemaphore, &waitStages,
-					1, &*commandBuffers[imageIndex],
+					1, &commandBuffer,
 					1, &renderFinishedSemaphore
 				};
 
 				device->resetFences(inFlightFence);
 				graphicsQueue.submit(submitInfo, inFlightFence);
+				trace.EndFrame();
 
 				vk::PresentInfoKHR presentInfo {
 					1, &renderFinishedSemaphore,
@@ -401,6 +411,15 @@ int main(int argc, char** argv) {
 			// Wait before destroying anything.
 			device->waitIdle();
 		}
+
+		simulation.Stop();
+
+		if (debugSink) {
+			uint64_t performanceWarnings = debugSink->CountOfType(vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance);
+			if (performanceWarnings > 0) {
+				std::cerr << "[Vulkan Debug] " << performanceWarnings << " performance warnings" << std::endl;
+			}
+		}
 	} catch (vk::SystemError const& e) {
 		std::cerr << "[Vulkan Fatal] " << e.what() << std::endl;
 		result = EXIT_FAILURE;
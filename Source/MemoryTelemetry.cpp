@@ -0,0 +1,176 @@
+#include "MemoryTelemetry.hpp"
+
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace py {
+char const* MemoryTagName(MemoryTag tag) {
+	switch (tag) {
+	case MemoryTag::Other:
+		return "Other";
+	case MemoryTag::RenderTargets:
+		return "RenderTargets";
+	case MemoryTag::Lighting:
+		return "Lighting";
+	case MemoryTag::Particles:
+		return "Particles";
+	default:
+		return "Unknown";
+	}
+}
+
+MemoryTelemetrySettings MemoryTelemetrySettings::Parse(int argc, char** argv) {
+	MemoryTelemetrySettings settings;
+	for (int i = 1; i < argc; ++i) {
+		char const* argument = argv[i];
+		if (std::strcmp(argument, "--memory-stats") == 0) {
+			settings.ReportStats = true;
+		} else if (char const* value = OptionValue(argument, "--memory-pressure")) {
+			settings.PressureThreshold = std::stod(value);
+			if (settings.PressureThreshold <= 0.0 || settings.PressureThreshold > 1.0) {
+				throw std::runtime_error("--memory-pressure must be greater than 0 and at most 1");
+			}
+		}
+	}
+	return settings;
+}
+
+static double ToMegabytes(vk::DeviceSize size) {
+	return static_cast<double>(size) / (1024.0 * 1024.0);
+}
+
+static void RaiseHighWaterMark(std::atomic<vk::DeviceSize>& highWaterMark, vk::DeviceSize value) {
+	vk::DeviceSize current = highWaterMark.load(std::memory_order_relaxed);
+	while (current < value && !highWaterMark.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+MemoryTelemetry::MemoryTelemetry(vk::PhysicalDevice const& physicalDevice, bool budgetEnabled)
+	: physicalDevice(physicalDevice), budgetEnabled(budgetEnabled), memoryProperties(physicalDevice.getMemoryProperties()) {
+	heaps.resize(memoryProperties.memoryHeapCount);
+	for (uint32_t index = 0; index < memoryProperties.memoryHeapCount; ++index) {
+		vk::MemoryHeap const& heap = memoryProperties.memoryHeaps[index];
+		heaps[index].Size = heap.size;
+		heaps[index].DeviceLocal = static_cast<bool>(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+		heaps[index].Budget = heap.size;
+	}
+}
+
+void MemoryTelemetry::OnAllocate(MemoryTag tag, uint32_t memoryTypeIndex, vk::DeviceSize size) {
+	uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	heapTracked[heapIndex].fetch_add(size, std::memory_order_relaxed);
+
+	size_t tagIndex = static_cast<size_t>(tag);
+	vk::DeviceSize usage = tagUsage[tagIndex].fetch_add(size, std::memory_order_relaxed) + size;
+	RaiseHighWaterMark(tagHighWaterMarks[tagIndex], usage);
+}
+
+void MemoryTelemetry::OnFree(MemoryTag tag, uint32_t memoryTypeIndex, vk::DeviceSize size) {
+	uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	heapTracked[heapIndex].fetch_sub(size, std::memory_order_relaxed);
+	tagUsage[static_cast<size_t>(tag)].fetch_sub(size, std::memory_order_relaxed);
+}
+
+void MemoryTelemetry::Update() {
+	if (budgetEnabled) {
+		auto properties = physicalDevice.getMemoryProperties2<
+			vk::PhysicalDeviceMemoryProperties2,
+			vk::PhysicalDeviceMemoryBudgetPropertiesEXT
+		>();
+		auto const& budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+		for (uint32_t index = 0; index < heaps.size(); ++index) {
+			heaps[index].Usage = budget.heapUsage[index];
+			heaps[index].Budget = budget.heapBudget[index];
+		}
+	}
+
+	for (uint32_t index = 0; index < heaps.size(); ++index) {
+		HeapUsage& heap = heaps[index];
+		heap.Tracked = heapTracked[index].load(std::memory_order_relaxed);
+		if (!budgetEnabled) {
+			heap.Usage = heap.Tracked;
+		}
+		heap.HighWaterMark = std::max(heap.HighWaterMark, heap.Usage);
+
+		for (auto const& listener : pressureListeners) {
+			auto limit = static_cast<vk::DeviceSize>(static_cast<double>(heap.Budget) * listener.Threshold);
+			if (heap.Usage > limit) {
+				listener.Callback(index, heap, heap.Usage - limit);
+			}
+		}
+	}
+}
+
+vk::DeviceSize MemoryTelemetry::TagUsage(MemoryTag tag) const {
+	return tagUsage[static_cast<size_t>(tag)].load(std::memory_order_relaxed);
+}
+
+vk::DeviceSize MemoryTelemetry::TagHighWaterMark(MemoryTag tag) const {
+	return tagHighWaterMarks[static_cast<size_t>(tag)].load(std::memory_order_relaxed);
+}
+
+void MemoryTelemetry::AddPressureCallback(double threshold, PressureCallback callback) {
+	pressureListeners.push_back(PressureListener { threshold, std::move(callback) });
+}
+
+void MemoryTelemetry::Print(std::ostream& out) const {
+	for (uint32_t index = 0; index < heaps.size(); ++index) {
+		HeapUsage const& heap = heaps[index];
+		out << "[Memory] Heap " << index << (heap.DeviceLocal ? " (device local): " : ": ")
+			<< ToMegabytes(heap.Usage) << " / " << ToMegabytes(heap.Budget) << " MiB used, "
+			<< ToMegabytes(heap.Tracked) << " MiB tracked, "
+			<< ToMegabytes(heap.HighWaterMark) << " MiB peak" << std::endl;
+	}
+	for (size_t index = 0; index < TagCount; ++index) {
+		MemoryTag tag = static_cast<MemoryTag>(index);
+		out << "[Memory] " << MemoryTagName(tag) << ": "
+			<< ToMegabytes(TagUsage(tag)) << " MiB, "
+			<< ToMegabytes(TagHighWaterMark(tag)) << " MiB peak" << std::endl;
+	}
+}
+
+DeviceMemory::DeviceMemory(
+	vk::UniqueDeviceMemory memory,
+	MemoryTelemetry& telemetry,
+	MemoryTag tag,
+	uint32_t memoryTypeIndex,
+	vk::DeviceSize size
+) : memory(std::move(memory)), telemetry(&telemetry), tag(tag), memoryTypeIndex(memoryTypeIndex), size(size) {
+	telemetry.OnAllocate(tag, memoryTypeIndex, size);
+}
+
+DeviceMemory::DeviceMemory(DeviceMemory&& other) noexcept
+	: memory(std::move(other.memory)),
+	telemetry(std::exchange(other.telemetry, nullptr)),
+	tag(other.tag),
+	memoryTypeIndex(other.memoryTypeIndex),
+	size(other.size) {}
+
+DeviceMemory& DeviceMemory::operator=(DeviceMemory&& other) noexcept {
+	if (this != &other) {
+		Release();
+		memory = std::move(other.memory);
+		telemetry = std::exchange(other.telemetry, nullptr);
+		tag = other.tag;
+		memoryTypeIndex = other.memoryTypeIndex;
+		size = other.size;
+	}
+	return *this;
+}
+
+DeviceMemory::~DeviceMemory() {
+	Release();
+}
+
+void DeviceMemory::Release() {
+	if (telemetry != nullptr) {
+		telemetry->OnFree(tag, memoryTypeIndex, size);
+		telemetry = nullptr;
+	}
+	memory.reset();
+}
+}
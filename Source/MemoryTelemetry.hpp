@@ -0,0 +1,131 @@
+#pragma once
+
+#define NOMINMAX
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+namespace py {
+// The subsystem an allocation is attributed to.
+enum class MemoryTag {
+    Other,
+    RenderTargets,
+    Lighting,
+    Particles,
+    Count
+};
+
+char const *MemoryTagName(MemoryTag tag);
+
+struct MemoryTelemetrySettings {
+    // Prints the usage of every heap and tag once per second.
+    bool ReportStats = false;
+
+    // The fraction of a heap's budget above which the heap is considered to be under pressure.
+    double PressureThreshold = 0.9;
+
+    // Reads --memory-stats and --memory-pressure= from the command line.
+    static MemoryTelemetrySettings Parse(int argc, char **argv);
+};
+
+// The state of a memory heap as of the last MemoryTelemetry::Update().
+struct HeapUsage {
+    vk::DeviceSize Size = 0;
+    bool DeviceLocal = false;
+
+    // What the driver reports for the whole process, or the tracked usage if VK_EXT_memory_budget isn't enabled.
+    vk::DeviceSize Usage = 0;
+
+    // How much the process can allocate before the driver may start paging. The heap size without
+    // VK_EXT_memory_budget.
+    vk::DeviceSize Budget = 0;
+
+    // What has been allocated through the telemetry.
+    vk::DeviceSize Tracked = 0;
+
+    vk::DeviceSize HighWaterMark = 0;
+};
+
+// Tracks device memory usage per heap and per tag, and warns when a heap runs close to its budget.
+class MemoryTelemetry {
+public:
+    // Invoked for every heap whose usage is above the pressure threshold, with how far over it the usage is.
+    using PressureCallback = std::function<void(uint32_t heapIndex, HeapUsage const &heap, vk::DeviceSize excess)>;
+
+    MemoryTelemetry(vk::PhysicalDevice const &physicalDevice, bool budgetEnabled);
+
+    vk::PhysicalDeviceMemoryProperties const &MemoryProperties() const { return memoryProperties; }
+
+    // Safe to call from any thread.
+    void OnAllocate(MemoryTag tag, uint32_t memoryTypeIndex, vk::DeviceSize size);
+    void OnFree(MemoryTag tag, uint32_t memoryTypeIndex, vk::DeviceSize size);
+
+    // Samples the usage and budget of every heap and raises pressure callbacks. Call once per frame.
+    void Update();
+
+    // The heaps as of the last Update().
+    std::vector<HeapUsage> const &Heaps() const { return heaps; }
+
+    vk::DeviceSize TagUsage(MemoryTag tag) const;
+    vk::DeviceSize TagHighWaterMark(MemoryTag tag) const;
+
+    // Registers a callback raised from Update() while a heap's usage is above the given fraction of its budget.
+    // Caches can use this to evict before the driver starts paging.
+    void AddPressureCallback(double threshold, PressureCallback callback);
+
+    // Writes the heaps as of the last Update() and the current usage of every tag.
+    void Print(std::ostream &out) const;
+
+private:
+    static constexpr size_t TagCount = static_cast<size_t>(MemoryTag::Count);
+
+    struct PressureListener {
+        double Threshold;
+        PressureCallback Callback;
+    };
+
+    vk::PhysicalDevice physicalDevice;
+    bool budgetEnabled;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+
+    std::array<std::atomic<vk::DeviceSize>, VK_MAX_MEMORY_HEAPS> heapTracked {};
+    std::array<std::atomic<vk::DeviceSize>, TagCount> tagUsage {};
+    std::array<std::atomic<vk::DeviceSize>, TagCount> tagHighWaterMarks {};
+
+    std::vector<HeapUsage> heaps;
+    std::vector<PressureListener> pressureListeners;
+};
+
+// Device memory that reports its allocation and release to a MemoryTelemetry.
+class DeviceMemory {
+public:
+    DeviceMemory() = default;
+    DeviceMemory(
+        vk::UniqueDeviceMemory memory,
+        MemoryTelemetry &telemetry,
+        MemoryTag tag,
+        uint32_t memoryTypeIndex,
+        vk::DeviceSize size
+    );
+    DeviceMemory(DeviceMemory &&other) noexcept;
+    DeviceMemory &operator=(DeviceMemory &&other) noexcept;
+    ~DeviceMemory();
+
+    vk::DeviceMemory operator*() const { return *memory; }
+    explicit operator bool() const { return static_cast<bool>(memory); }
+
+private:
+    void Release();
+
+    vk::UniqueDeviceMemory memory;
+    MemoryTelemetry *telemetry = nullptr;
+    MemoryTag tag = MemoryTag::Other;
+    uint32_t memoryTypeIndex = 0;
+    vk::DeviceSize size = 0;
+};
+}
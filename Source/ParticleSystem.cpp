@@ -0,0 +1,330 @@
+#include "ParticleSystem.hpp"
+
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace py {
+static std::vector<uint32_t> const InitShaderIL {
+	#include "Shaders/ParticleInit.comp.spv"
+};
+
+static std::vector<uint32_t> const KickoffShaderIL {
+	#include "Shaders/ParticleKickoff.comp.spv"
+};
+
+static std::vector<uint32_t> const EmitShaderIL {
+	#include "Shaders/ParticleEmit.comp.spv"
+};
+
+static std::vector<uint32_t> const SimulateShaderIL {
+	#include "Shaders/ParticleSimulate.comp.spv"
+};
+
+static std::vector<uint32_t> const FinalizeShaderIL {
+	#include "Shaders/ParticleFinalize.comp.spv"
+};
+
+// Must match GroupSize in Particles.glsl.
+static constexpr uint32_t GroupSize = 256;
+
+// The largest number of groups a single dispatch is guaranteed to support.
+static constexpr uint32_t MaxGroupCount = 65535;
+
+// The average lifetime of a particle, as launched by ParticleEmit.comp.
+static constexpr double AverageLifetime = 3.0;
+
+// Matches the ControlBuffer block in Particles.glsl.
+struct ParticleControl {
+	uint32_t EmitDispatch[4];
+	uint32_t SimulateDispatch[4];
+	uint32_t Draw[4];
+	uint32_t Capacity;
+	uint32_t DeadCount;
+	uint32_t EmitCount;
+	uint32_t Unused;
+	uint32_t AliveCount[2];
+};
+
+static constexpr vk::DeviceSize EmitDispatchOffset = offsetof(ParticleControl, EmitDispatch);
+static constexpr vk::DeviceSize SimulateDispatchOffset = offsetof(ParticleControl, SimulateDispatch);
+static constexpr vk::DeviceSize DrawOffset = offsetof(ParticleControl, Draw);
+
+// Matches the PushConstants block in Particles.glsl.
+struct ParticlePushConstants {
+	float DeltaTime;
+	float Time;
+	uint32_t EmitRequest;
+	uint32_t Current;
+};
+
+// Matches the PushConstants block in Particle.vert.
+struct ParticleDrawPushConstants {
+	uint32_t AliveListOffset;
+};
+
+ParticleSettings ParticleSettings::Parse(int argc, char** argv) {
+	ParticleSettings settings;
+	for (int i = 1; i < argc; ++i) {
+		char const* argument = argv[i];
+		if (char const* value = OptionValue(argument, "--particles")) {
+			long long capacity = std::stoll(value);
+			if (capacity < 1 || capacity > static_cast<long long>(MaxGroupCount) * GroupSize) {
+				throw std::runtime_error("--particles must be between 1 and " + std::to_string(MaxGroupCount * GroupSize));
+			}
+			settings.Capacity = static_cast<uint32_t>(capacity);
+		} else if (char const* value = OptionValue(argument, "--particle-emit-rate")) {
+			settings.EmitRate = std::stod(value);
+			if (settings.EmitRate < 0.0) {
+				throw std::runtime_error("--particle-emit-rate must not be negative");
+			}
+		} else if (std::strcmp(argument, "--particle-stats") == 0) {
+			settings.ReportStats = true;
+		}
+	}
+	return settings;
+}
+
+static vk::UniquePipeline BuildComputePipeline(
+	vk::Device const& device,
+	vk::PipelineLayout const& pipelineLayout,
+	std::vector<uint32_t> const& il
+) {
+	vk::UniqueShaderModule shaderModule = BuildShaderModule(device, il);
+	vk::ComputePipelineCreateInfo pipelineInfo {
+		{},
+		vk::PipelineShaderStageCreateInfo {
+			{},
+			vk::ShaderStageFlagBits::eCompute,
+			*shaderModule,
+			"main"
+		},
+		pipelineLayout
+	};
+	return device.createComputePipelineUnique({}, pipelineInfo);
+}
+
+ParticleSystem::ParticleSystem(
+	MemoryTelemetry& telemetry,
+	vk::Device const& device,
+	ParticleSettings const& settings
+) : settings(settings) {
+	emitRate = settings.EmitRate > 0.0 ? settings.EmitRate : settings.Capacity / AverageLifetime;
+
+	vk::DeviceSize capacity = settings.Capacity;
+	vk::MemoryPropertyFlags deviceMemory = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	particles = Buffer::Build(
+		telemetry, device,
+		capacity * sizeof(float) * 8,
+		vk::BufferUsageFlagBits::eStorageBuffer,
+		deviceMemory,
+		MemoryTag::Particles
+	);
+	deadList = Buffer::Build(
+		telemetry, device,
+		capacity * sizeof(uint32_t),
+		vk::BufferUsageFlagBits::eStorageBuffer,
+		deviceMemory,
+		MemoryTag::Particles
+	);
+	aliveLists = Buffer::Build(
+		telemetry, device,
+		capacity * sizeof(uint32_t) * 2,
+		vk::BufferUsageFlagBits::eStorageBuffer,
+		deviceMemory,
+		MemoryTag::Particles
+	);
+	control = Buffer::Build(
+		telemetry, device,
+		sizeof(ParticleControl),
+		vk::BufferUsageFlagBits::eStorageBuffer |
+		vk::BufferUsageFlagBits::eIndirectBuffer |
+		vk::BufferUsageFlagBits::eTransferDst,
+		deviceMemory,
+		MemoryTag::Particles
+	);
+
+	vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex;
+	std::array<vk::DescriptorSetLayoutBinding, 4> bindings {
+		vk::DescriptorSetLayoutBinding { 0, vk::DescriptorType::eStorageBuffer, 1, stages },
+		vk::DescriptorSetLayoutBinding { 1, vk::DescriptorType::eStorageBuffer, 1, stages },
+		vk::DescriptorSetLayoutBinding { 2, vk::DescriptorType::eStorageBuffer, 1, stages },
+		vk::DescriptorSetLayoutBinding { 3, vk::DescriptorType::eStorageBuffer, 1, stages }
+	};
+	setLayout = device.createDescriptorSetLayoutUnique({
+		{},
+		static_cast<uint32_t>(bindings.size()), bindings.data()
+	});
+
+	vk::DescriptorPoolSize poolSize { vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(bindings.size()) };
+	descriptorPool = device.createDescriptorPoolUnique({ {}, 1, 1, &poolSize });
+	set = device.allocateDescriptorSets({ *descriptorPool, 1, &*setLayout }).front();
+
+	std::array<vk::DescriptorBufferInfo, 4> bufferInfos {
+		vk::DescriptorBufferInfo { *particles.Handle, 0, VK_WHOLE_SIZE },
+		vk::DescriptorBufferInfo { *deadList.Handle, 0, VK_WHOLE_SIZE },
+		vk::DescriptorBufferInfo { *aliveLists.Handle, 0, VK_WHOLE_SIZE },
+		vk::DescriptorBufferInfo { *control.Handle, 0, VK_WHOLE_SIZE }
+	};
+	std::array<vk::WriteDescriptorSet, 4> writes;
+	for (uint32_t binding = 0; binding < writes.size(); ++binding) {
+		writes[binding] = vk::WriteDescriptorSet {
+			set,
+			binding,
+			0,
+			1,
+			vk::DescriptorType::eStorageBuffer,
+			nullptr,
+			&bufferInfos[binding]
+		};
+	}
+	device.updateDescriptorSets(writes, nullptr);
+
+	vk::PushConstantRange pushConstantRange {
+		vk::ShaderStageFlagBits::eCompute,
+		0,
+		sizeof(ParticlePushConstants)
+	};
+	pipelineLayout = device.createPipelineLayoutUnique({ {}, 1, &*setLayout, 1, &pushConstantRange });
+
+	initPipeline = BuildComputePipeline(device, *pipelineLayout, InitShaderIL);
+	kickoffPipeline = BuildComputePipeline(device, *pipelineLayout, KickoffShaderIL);
+	emitPipeline = BuildComputePipeline(device, *pipelineLayout, EmitShaderIL);
+	simulatePipeline = BuildComputePipeline(device, *pipelineLayout, SimulateShaderIL);
+	finalizePipeline = BuildComputePipeline(device, *pipelineLayout, FinalizeShaderIL);
+}
+
+vk::PushConstantRange ParticleSystem::DrawPushConstantRange() {
+	return vk::PushConstantRange {
+		vk::ShaderStageFlagBits::eVertex,
+		0,
+		sizeof(ParticleDrawPushConstants)
+	};
+}
+
+// Makes the writes of one compute pass visible to the next.
+static void ComputeToComputeBarrier(vk::CommandBuffer const& commandBuffer, vk::AccessFlags extraAccess = {}) {
+	vk::MemoryBarrier barrier {
+		vk::AccessFlagBits::eShaderWrite,
+		vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | extraAccess
+	};
+	vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eComputeShader;
+	if (extraAccess & vk::AccessFlagBits::eIndirectCommandRead) {
+		dstStages |= vk::PipelineStageFlagBits::eDrawIndirect;
+	}
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, dstStages, {}, barrier, nullptr, nullptr);
+}
+
+void ParticleSystem::RecordSimulation(vk::CommandBuffer const& commandBuffer, float deltaTime, float time) {
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, set, nullptr);
+
+	if (!initialized) {
+		ParticleControl initialControl {
+			{ 0, 1, 1, 0 },
+			{ 0, 1, 1, 0 },
+			{ 0, 1, 0, 0 },
+			settings.Capacity,
+			settings.Capacity,
+			0,
+			0,
+			{ 0, 0 }
+		};
+		commandBuffer.updateBuffer(*control.Handle, 0, sizeof(initialControl), &initialControl);
+
+		vk::MemoryBarrier controlWritten {
+			vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+		};
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eComputeShader,
+			{},
+			controlWritten, nullptr, nullptr
+		);
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *initPipeline);
+		commandBuffer.dispatch((settings.Capacity + GroupSize - 1) / GroupSize, 1, 1);
+		ComputeToComputeBarrier(commandBuffer);
+		initialized = true;
+	} else {
+		// The previous frame's draw may still be reading what this step is about to overwrite, and its compute
+		// writes have only been made visible to the draw so far.
+		vk::MemoryBarrier previousFrame {
+			vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+		};
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader |
+			vk::PipelineStageFlagBits::eDrawIndirect |
+			vk::PipelineStageFlagBits::eVertexShader,
+			vk::PipelineStageFlagBits::eComputeShader,
+			{},
+			previousFrame, nullptr, nullptr
+		);
+	}
+
+	double emitCount = emitRate * deltaTime + emitRemainder;
+	double emitWhole = std::floor(emitCount);
+	emitRemainder = emitCount - emitWhole;
+
+	ParticlePushConstants pushConstants {
+		deltaTime,
+		time,
+		static_cast<uint32_t>(std::min<double>(emitWhole, settings.Capacity)),
+		currentList
+	};
+	commandBuffer.pushConstants(
+		*pipelineLayout,
+		vk::ShaderStageFlagBits::eCompute,
+		0, sizeof(pushConstants), &pushConstants
+	);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *kickoffPipeline);
+	commandBuffer.dispatch(1, 1, 1);
+	ComputeToComputeBarrier(commandBuffer, vk::AccessFlagBits::eIndirectCommandRead);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *emitPipeline);
+	commandBuffer.dispatchIndirect(*control.Handle, EmitDispatchOffset);
+	ComputeToComputeBarrier(commandBuffer);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *simulatePipeline);
+	commandBuffer.dispatchIndirect(*control.Handle, SimulateDispatchOffset);
+	ComputeToComputeBarrier(commandBuffer);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *finalizePipeline);
+	commandBuffer.dispatch(1, 1, 1);
+
+	// Hand the survivors and the draw arguments over to the draw.
+	vk::MemoryBarrier simulated {
+		vk::AccessFlagBits::eShaderWrite,
+		vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eIndirectCommandRead
+	};
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+		{},
+		simulated, nullptr, nullptr
+	);
+
+	currentList = 1 - currentList;
+}
+
+void ParticleSystem::RecordDraw(vk::CommandBuffer const& commandBuffer, vk::PipelineLayout const& drawLayout) const {
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, drawLayout, 1, set, nullptr);
+
+	// The last step compacted its survivors into what is now the current list.
+	ParticleDrawPushConstants pushConstants { currentList * settings.Capacity };
+	commandBuffer.pushConstants(
+		drawLayout,
+		vk::ShaderStageFlagBits::eVertex,
+		0, sizeof(pushConstants), &pushConstants
+	);
+	commandBuffer.drawIndirect(*control.Handle, DrawOffset, 1, 0);
+}
+}
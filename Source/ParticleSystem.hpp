@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+namespace py {
+struct ParticleSettings {
+    uint32_t Capacity = 262144;
+
+    // Particles launched per second. 0 picks a rate that keeps the system close to full.
+    double EmitRate = 0.0;
+
+    // Periodically prints the GPU time spent simulating the particles.
+    bool ReportStats = false;
+
+    // Reads --particles=, --particle-emit-rate= and --particle-stats from the command line.
+    static ParticleSettings Parse(int argc, char **argv);
+};
+
+// A particle system that lives entirely on the GPU. Emission, integration and compaction of the alive particles
+// run in compute passes, and the number of particles to draw is handed to an indirect draw, so the CPU never
+// touches or reads back a single particle.
+class ParticleSystem {
+public:
+    ParticleSystem(MemoryTelemetry &telemetry, vk::Device const &device, ParticleSettings const &settings);
+
+    // The layout of the set that the draw binds at index 1, after the scene set.
+    vk::DescriptorSetLayout SetLayout() const { return *setLayout; }
+
+    // The push constants used by the draw.
+    static vk::PushConstantRange DrawPushConstantRange();
+
+    // Records one simulation step. Must be recorded outside of a render pass, once per frame.
+    void RecordSimulation(vk::CommandBuffer const &commandBuffer, float deltaTime, float time);
+
+    // Draws the particles that survived the last simulation step. Expects a pipeline built from Particle.vert and
+    // Particle.frag to be bound along with the scene set.
+    void RecordDraw(vk::CommandBuffer const &commandBuffer, vk::PipelineLayout const &pipelineLayout) const;
+
+private:
+    ParticleSettings settings;
+    double emitRate;
+    double emitRemainder = 0.0;
+    bool initialized = false;
+
+    // The alive list that the next simulation step appends to.
+    uint32_t currentList = 0;
+
+    Buffer particles;
+    Buffer deadList;
+    Buffer aliveLists;
+    Buffer control;
+
+    vk::UniqueDescriptorSetLayout setLayout;
+    vk::UniqueDescriptorPool descriptorPool;
+    vk::DescriptorSet set;
+
+    vk::UniquePipelineLayout pipelineLayout;
+    vk::UniquePipeline initPipeline;
+    vk::UniquePipeline kickoffPipeline;
+    vk::UniquePipeline emitPipeline;
+    vk::UniquePipeline simulatePipeline;
+    vk::UniquePipeline finalizePipeline;
+};
+}
@@ -0,0 +1,405 @@
+#include <vulkan/vulkan.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ClusteredLighting.hpp"
+#include "DebugMessageSink.hpp"
+#include "DynamicResolution.hpp"
+#include "GpuTimer.hpp"
+#include "MemoryTelemetry.hpp"
+#include "ParticleSystem.hpp"
+#include "Scene.hpp"
+#include "Trace.hpp"
+#include "Vulkan.hpp"
+
+using namespace py;
+using Clock = std::chrono::steady_clock;
+
+// What was measured for one replayed frame.
+struct FrameTiming {
+	// Time spent recording and submitting the frame, not counting the wait for its resources to be released.
+	double CpuSubmitMilliseconds;
+	std::optional<double> GpuMilliseconds;
+};
+
+// Stands in for a swapchain image, so that replayed frames end with the same upscale as live ones.
+struct PresentImage {
+	vk::UniqueImage Image;
+	DeviceMemory Memory;
+
+	static PresentImage Build(
+		MemoryTelemetry& telemetry,
+		vk::Device const& device,
+		vk::Format format,
+		vk::Extent2D const& extent
+	) {
+		PresentImage image;
+		vk::ImageCreateInfo imageInfo {
+			{},
+			vk::ImageType::e2D,
+			format,
+			vk::Extent3D { extent.width, extent.height, 1 },
+			1,
+			1,
+			vk::SampleCountFlagBits::e1,
+			vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive,
+			0, nullptr,
+			vk::ImageLayout::eUndefined
+		};
+		image.Image = device.createImageUnique(imageInfo);
+		image.Memory = AllocateMemory(
+			telemetry,
+			device,
+			device.getImageMemoryRequirements(*image.Image),
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			MemoryTag::RenderTargets
+		);
+		device.bindImageMemory(*image.Image, *image.Memory, 0);
+		return image;
+	}
+};
+
+// Everything a trace rebuilds whenever the recorded swapchain was recreated. The replay never presents, so each
+// frame in flight upscales into its own offscreen image of the recorded swapchain size instead.
+struct FrameResources {
+	FrameResources(
+		PhysicalDeviceDetails const& physicalDevice,
+		vk::Device const& device,
+		vk::CommandPool const& commandPool,
+		MemoryTelemetry& memoryTelemetry,
+		ParticleSystem const& particles,
+		TraceFrameResources const& recorded
+	) :
+		Lighting(memoryTelemetry, device, recorded.FrameCount, recorded.LightCount),
+		Scene(ScenePipelines::Build(device, recorded.Format, Lighting.SetLayout(), particles.SetLayout())),
+		CommandBuffers(device.allocateCommandBuffersUnique(
+			{ commandPool, vk::CommandBufferLevel::ePrimary, recorded.FrameCount }
+		)),
+		Timer(physicalDevice, device, recorded.FrameCount),
+		Extent(recorded.Extent),
+		UpscaleFilter(ChooseUpscaleFilter(physicalDevice.Device, recorded.Format)),
+		SlotFrames(recorded.FrameCount) {
+		RenderTargets.reserve(recorded.FrameCount);
+		PresentImages.reserve(recorded.FrameCount);
+		Fences.reserve(recorded.FrameCount);
+		for (uint32_t i = 0; i < recorded.FrameCount; ++i) {
+			RenderTargets.emplace_back(
+				RenderTarget::Build(memoryTelemetry, device, *Scene.RenderPass, recorded.Format, recorded.Extent)
+			);
+			PresentImages.emplace_back(PresentImage::Build(memoryTelemetry, device, recorded.Format, recorded.Extent));
+			Fences.emplace_back(device.createFenceUnique({ vk::FenceCreateFlagBits::eSignaled }));
+		}
+	}
+
+	ClusteredLighting Lighting;
+	ScenePipelines Scene;
+	std::vector<RenderTarget> RenderTargets;
+	std::vector<PresentImage> PresentImages;
+	std::vector<vk::UniqueCommandBuffer> CommandBuffers;
+	std::vector<vk::UniqueFence> Fences;
+	GpuTimer Timer;
+	vk::Extent2D Extent;
+	vk::Filter UpscaleFilter;
+
+	// The frame each slot was last submitted for, so that its GPU time can be attributed once it is read back.
+	std::vector<std::optional<size_t>> SlotFrames;
+};
+
+// Reads back the GPU time of whatever the slot last rendered. The slot's fence must have been waited on.
+static void CollectGpuTime(FrameResources& resources, uint32_t slot, std::vector<FrameTiming>& timings) {
+	if (!resources.SlotFrames[slot]) {
+		return;
+	}
+	if (std::optional<double> gpuSeconds = resources.Timer.Read(slot)) {
+		timings[*resources.SlotFrames[slot]].GpuMilliseconds = *gpuSeconds * 1000.0;
+	}
+	resources.SlotFrames[slot].reset();
+}
+
+static void CollectAllGpuTimes(FrameResources& resources, std::vector<FrameTiming>& timings) {
+	for (uint32_t slot = 0; slot < resources.SlotFrames.size(); ++slot) {
+		CollectGpuTime(resources, slot, timings);
+	}
+}
+
+static void PrintStatistics(char const* name, std::vector<double> samples) {
+	if (samples.empty()) {
+		std::cerr << name << ": no samples" << std::endl;
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (double sample : samples) {
+		total += sample;
+	}
+	auto percentile = [&](double fraction) {
+		return samples[static_cast<size_t>(fraction * (samples.size() - 1))];
+	};
+	std::cerr << std::fixed << std::setprecision(3) << name << ": "
+		<< total / samples.size() << " ms mean, "
+		<< percentile(0.5) << " ms median, "
+		<< percentile(0.95) << " ms p95, "
+		<< samples.back() << " ms max" << std::endl;
+}
+
+static FrameResources& RequireFrameResources(std::unique_ptr<FrameResources> const& resources) {
+	if (!resources) {
+		throw std::runtime_error("trace records a frame before creating its resources");
+	}
+	return *resources;
+}
+
+// Everything but resource creation and frame boundaries records into the frame's command buffer, which only exists
+// between BeginFrame and EndFrame.
+static FrameResources& RequireOpenFrame(std::unique_ptr<FrameResources> const& resources, bool frameOpen) {
+	if (!frameOpen) {
+		throw std::runtime_error("trace records an operation outside a frame");
+	}
+	return RequireFrameResources(resources);
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: PyriteReplay <trace>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+	try {
+		TraceReader trace(argv[1]);
+
+		InitializeDefaultDispatcher();
+		vk::ApplicationInfo appInfo = BuildApplicationInfo(VK_API_VERSION_1_1);
+		// Must outlive the instance, which reports to it until it is destroyed. Only built when debugging, as its logger
+		// thread would otherwise run for nothing.
+		std::optional<DebugMessageSink> debugSink;
+#ifdef NDEBUG
+		vk::UniqueInstance instance = InitializeVulkan(appInfo, {}, {}, false, nullptr);
+#else
+		debugSink.emplace();
+		vk::UniqueInstance instance = InitializeVulkan(
+			appInfo,
+			{ VK_EXT_DEBUG_UTILS_EXTENSION_NAME },
+			{ "VK_LAYER_KHRONOS_validation" },
+			true,
+			&*debugSink
+		);
+		vk::UniqueDebugUtilsMessengerEXT debugMessenger =
+			instance->createDebugUtilsMessengerEXTUnique(BuildDebugMessengerCreateInfo(&*debugSink));
+#endif
+
+		PhysicalDeviceDetails physicalDeviceDetails = ChooseHeadlessPhysicalDevice(*instance);
+		std::cerr << "[Replay] Using " << physicalDeviceDetails.Properties.deviceName << std::endl;
+
+		std::vector<std::string> deviceExtensions;
+		if (physicalDeviceDetails.HasMemoryBudget) {
+			deviceExtensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+		uint32_t graphicsFamilyIndex = physicalDeviceDetails.GraphicsFamilyIndex.value();
+#ifdef NDEBUG
+		vk::UniqueDevice device = BuildDevice(physicalDeviceDetails.Device, { graphicsFamilyIndex }, deviceExtensions, {}, false);
+#else
+		vk::UniqueDevice device = BuildDevice(
+			physicalDeviceDetails.Device,
+			{ graphicsFamilyIndex },
+			deviceExtensions,
+			{ "VK_LAYER_KHRONOS_validation" },
+			true
+		);
+#endif
+
+		vk::Queue graphicsQueue = device->getQueue(graphicsFamilyIndex, 0);
+		vk::UniqueCommandPool commandPool = device->createCommandPoolUnique({
+			vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+			graphicsFamilyIndex
+		});
+
+		// Must outlive every allocation, which reports to it when freed.
+		MemoryTelemetry memoryTelemetry(physicalDeviceDetails.Device, physicalDeviceDetails.HasMemoryBudget);
+
+		std::unique_ptr<ParticleSystem> particles;
+		std::unique_ptr<FrameResources> resources;
+
+		std::vector<FrameTiming> timings;
+		uint32_t slot = 0;
+		vk::CommandBuffer commandBuffer;
+		bool frameOpen = false;
+		Clock::time_point frameStart;
+
+		// Time spent reading the lights back from the trace, which the live renderer doesn't pay for and which isn't
+		// counted towards the submit time.
+		Clock::duration excludedTime {};
+
+		while (std::optional<TraceOp> op = trace.NextOp()) {
+			switch (*op) {
+			case TraceOp::CreateParticleSystem: {
+				TraceParticleSystem recorded = trace.ReadParticleSystem();
+				if (frameOpen) {
+					throw std::runtime_error("trace creates the particle system inside a frame");
+				}
+				device->waitIdle();
+				ParticleSettings settings;
+				settings.Capacity = recorded.Capacity;
+				settings.EmitRate = recorded.EmitRate;
+				particles = std::make_unique<ParticleSystem>(memoryTelemetry, *device, settings);
+				break;
+			}
+			case TraceOp::CreateFrameResources: {
+				TraceFrameResources recorded = trace.ReadFrameResources();
+				if (!particles) {
+					throw std::runtime_error("trace creates frame resources before the particle system");
+				}
+				if (frameOpen) {
+					throw std::runtime_error("trace creates frame resources inside a frame");
+				}
+
+				device->waitIdle();
+				if (resources) {
+					CollectAllGpuTimes(*resources, timings);
+					resources.reset();
+				}
+				resources = std::make_unique<FrameResources>(
+					physicalDeviceDetails,
+					*device,
+					*commandPool,
+					memoryTelemetry,
+					*particles,
+					recorded
+				);
+				break;
+			}
+			case TraceOp::BeginFrame: {
+				FrameResources& frame = RequireFrameResources(resources);
+				slot = trace.ReadBeginFrame().Slot;
+				if (slot >= frame.Fences.size()) {
+					throw std::runtime_error("trace records a frame in an unknown slot");
+				}
+				if (frameOpen) {
+					throw std::runtime_error("trace begins a frame inside another frame");
+				}
+				frameOpen = true;
+
+				device->waitForFences(*frame.Fences[slot], true, std::numeric_limits<uint64_t>::max());
+				CollectGpuTime(frame, slot, timings);
+
+				frameStart = Clock::now();
+				excludedTime = Clock::duration::zero();
+				commandBuffer = *frame.CommandBuffers[slot];
+				commandBuffer.reset({});
+				commandBuffer.begin(vk::CommandBufferBeginInfo { vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+				frame.Timer.Begin(commandBuffer, slot);
+				break;
+			}
+			case TraceOp::UploadLighting: {
+				FrameResources& frame = RequireOpenFrame(resources, frameOpen);
+				Clock::time_point readStart = Clock::now();
+				TraceLightingUpload recorded = trace.ReadLightingUpload();
+				excludedTime += Clock::now() - readStart;
+
+				frame.Lighting.Update(slot, recorded.Uniforms, recorded.Lights);
+				break;
+			}
+			case TraceOp::CullLights:
+				RequireOpenFrame(resources, frameOpen).Lighting.RecordCulling(commandBuffer, slot);
+				break;
+			case TraceOp::SimulateParticles: {
+				RequireOpenFrame(resources, frameOpen);
+				TraceParticleStep recorded = trace.ReadParticleStep();
+				particles->RecordSimulation(commandBuffer, recorded.DeltaTime, recorded.Time);
+				break;
+			}
+			case TraceOp::DrawScene: {
+				FrameResources& frame = RequireOpenFrame(resources, frameOpen);
+				TraceSceneDraw recorded = trace.ReadSceneDraw();
+				RecordSceneCommands(
+					commandBuffer,
+					frame.Scene,
+					*frame.RenderTargets[slot].Framebuffer,
+					recorded.Extent,
+					frame.Lighting.DescriptorSet(slot),
+					*particles,
+					recorded.Rotation
+				);
+				// Live frames always finish by scaling into the swapchain image, which is part of their GPU time.
+				RecordUpscale(
+					commandBuffer,
+					frame.RenderTargets[slot],
+					recorded.Extent,
+					*frame.PresentImages[slot].Image,
+					frame.Extent,
+					frame.UpscaleFilter,
+					vk::ImageLayout::eTransferDstOptimal
+				);
+				break;
+			}
+			case TraceOp::EndFrame: {
+				FrameResources& frame = RequireOpenFrame(resources, frameOpen);
+				frameOpen = false;
+				frame.Timer.End(commandBuffer, slot);
+				commandBuffer.end();
+
+				vk::SubmitInfo submitInfo { 0, nullptr, nullptr, 1, &commandBuffer };
+				device->resetFences(*frame.Fences[slot]);
+				graphicsQueue.submit(submitInfo, *frame.Fences[slot]);
+
+				Clock::duration submitTime = Clock::now() - frameStart - excludedTime;
+				timings.push_back(FrameTiming {
+					std::chrono::duration<double, std::milli>(submitTime).count(),
+					std::nullopt
+				});
+				frame.SlotFrames[slot] = timings.size() - 1;
+				break;
+			}
+			}
+		}
+		if (frameOpen) {
+			std::cerr << "[Replay] Trace ends inside a frame, which was dropped" << std::endl;
+		}
+
+		device->waitIdle();
+		if (resources) {
+			CollectAllGpuTimes(*resources, timings);
+		}
+
+		std::cout << "frame,cpu_submit_ms,gpu_ms" << std::endl;
+		std::vector<double> cpuSamples;
+		std::vector<double> gpuSamples;
+		for (size_t i = 0; i < timings.size(); ++i) {
+			FrameTiming const& timing = timings[i];
+			std::cout << i << "," << timing.CpuSubmitMilliseconds << ",";
+			if (timing.GpuMilliseconds) {
+				std::cout << *timing.GpuMilliseconds;
+				gpuSamples.push_back(*timing.GpuMilliseconds);
+			}
+			std::cout << "\n";
+			cpuSamples.push_back(timing.CpuSubmitMilliseconds);
+		}
+		std::cout << std::flush;
+
+		std::cerr << "[Replay] " << timings.size() << " frames" << std::endl;
+		PrintStatistics("[Replay] CPU submit", cpuSamples);
+		PrintStatistics("[Replay] GPU", gpuSamples);
+	} catch (vk::SystemError const& e) {
+		std::cerr << "[Vulkan Fatal] " << e.what() << std::endl;
+		result = EXIT_FAILURE;
+	} catch (std::exception const& e) {
+		std::cerr << "[Fatal] " <<  e.what() << std::endl;
+		result = EXIT_FAILURE;
+	}
+
+	return result;
+}
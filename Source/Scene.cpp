@@ -0,0 +1,297 @@
+#include "Scene.hpp"
+
+#include <array>
+
+namespace py {
+static std::vector<uint32_t> const VertexShaderIL {
+	#include "Shaders/Triangle.vert.spv"
+};
+
+static std::vector<uint32_t> const FragmentShaderIL {
+	#include "Shaders/Triangle.frag.spv"
+};
+
+static std::vector<uint32_t> const ParticleVertexShaderIL {
+	#include "Shaders/Particle.vert.spv"
+};
+
+static std::vector<uint32_t> const ParticleFragmentShaderIL {
+	#include "Shaders/Particle.frag.spv"
+};
+
+// Mirrors the push constant block in Triangle.vert.
+struct ScenePushConstants {
+	float Rotation;
+};
+
+static vk::UniqueRenderPass BuildRenderPass(vk::Device const& device, vk::Format const& format) {
+	vk::AttachmentDescription colorAttachment {
+		{},
+		format,
+		vk::SampleCountFlagBits::e1,
+		vk::AttachmentLoadOp::eClear,
+		vk::AttachmentStoreOp::eStore,
+		vk::AttachmentLoadOp::eDontCare,
+		vk::AttachmentStoreOp::eDontCare,
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eTransferSrcOptimal
+	};
+	vk::AttachmentReference colorAttachementRef {
+		0,
+		vk::ImageLayout::eColorAttachmentOptimal
+	};
+
+	vk::SubpassDescription subpass {
+		{},
+		vk::PipelineBindPoint::eGraphics,
+		0, nullptr,
+		1, &colorAttachementRef
+	};
+
+	std::array<vk::SubpassDependency, 2> dependencies {
+		vk::SubpassDependency {
+			VK_SUBPASS_EXTERNAL,
+			0,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			{},
+			vk::AccessFlagBits::eColorAttachmentWrite
+		},
+		// The render target is scaled into the swapchain image, or read back, afterwards.
+		vk::SubpassDependency {
+			0,
+			VK_SUBPASS_EXTERNAL,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlagBits::eColorAttachmentWrite,
+			vk::AccessFlagBits::eTransferRead
+		}
+	};
+
+	vk::RenderPassCreateInfo renderPassInfo {
+		{},
+		1, &colorAttachment,
+		1, &subpass,
+		static_cast<uint32_t>(dependencies.size()), dependencies.data()
+	};
+	return device.createRenderPassUnique(renderPassInfo);
+}
+
+enum class BlendMode {
+	Opaque,
+	Additive
+};
+
+static vk::UniquePipeline BuildGraphicsPipeline(
+	vk::Device const& device,
+	std::vector<uint32_t> const& vertexShaderIL,
+	std::vector<uint32_t> const& fragmentShaderIL,
+	BlendMode blendMode,
+	vk::PipelineLayout const& pipelineLayout,
+	vk::RenderPass const& renderPass
+) {
+	vk::UniqueShaderModule vertexShaderModule = BuildShaderModule(device, vertexShaderIL);
+	vk::UniqueShaderModule fragmentShaderModule = BuildShaderModule(device, fragmentShaderIL);
+	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages {
+		vk::PipelineShaderStageCreateInfo {
+			{},
+			vk::ShaderStageFlagBits::eVertex,
+			*vertexShaderModule,
+			"main"
+		},
+		vk::PipelineShaderStageCreateInfo {
+			{},
+			vk::ShaderStageFlagBits::eFragment,
+			*fragmentShaderModule,
+			"main"
+		}
+	};
+
+	// TODO: For now, the defaults are fine as the vertex data is coming from the shader itself.
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
+
+	vk::PipelineInputAssemblyStateCreateInfo assemblyInputInfo {
+		{},
+		vk::PrimitiveTopology::eTriangleList,
+		false
+	};
+
+	// The viewport and scissor follow the render resolution, which changes without rebuilding the pipeline.
+	vk::PipelineViewportStateCreateInfo viewportStateInfo {
+		{},
+		1, nullptr,
+		1, nullptr
+	};
+	std::array<vk::DynamicState, 2> dynamicStates {
+		vk::DynamicState::eViewport,
+		vk::DynamicState::eScissor
+	};
+	vk::PipelineDynamicStateCreateInfo dynamicStateInfo {
+		{},
+		static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data()
+	};
+
+	vk::PipelineRasterizationStateCreateInfo rasterizerInfo {
+		{},
+		false,
+		false,
+		vk::PolygonMode::eFill,
+		vk::CullModeFlagBits::eNone,
+		vk::FrontFace::eClockwise,
+		false,
+		0.0f,
+		0.0f,
+		0.0f,
+		1.0f
+	};
+
+	vk::PipelineMultisampleStateCreateInfo multisamplingInfo {
+		{},
+		vk::SampleCountFlagBits::e1,
+		false,
+		1.0f,
+		nullptr,
+		false,
+		false
+	};
+
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment {
+		blendMode == BlendMode::Additive,
+		vk::BlendFactor::eOne,
+		blendMode == BlendMode::Additive ? vk::BlendFactor::eOne : vk::BlendFactor::eZero,
+		vk::BlendOp::eAdd,
+		vk::BlendFactor::eOne,
+		vk::BlendFactor::eZero,
+		vk::BlendOp::eAdd,
+		vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+		vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+	};
+	vk::PipelineColorBlendStateCreateInfo colorBlendInfo {
+		{},
+		false,
+		vk::LogicOp::eCopy,
+		1, &colorBlendAttachment
+	};
+
+	vk::GraphicsPipelineCreateInfo pipelineInfo {
+		{},
+		static_cast<uint32_t>(shaderStages.size()), shaderStages.data(),
+		&vertexInputInfo,
+		&assemblyInputInfo,
+		nullptr,
+		&viewportStateInfo,
+		&rasterizerInfo,
+		&multisamplingInfo,
+		nullptr,
+		&colorBlendInfo,
+		&dynamicStateInfo,
+		pipelineLayout,
+		renderPass,
+		0
+	};
+	return device.createGraphicsPipelineUnique({}, pipelineInfo);
+}
+
+static vk::UniquePipelineLayout BuildScenePipelineLayout(
+	vk::Device const& device,
+	vk::DescriptorSetLayout const& sceneSetLayout
+) {
+	vk::PushConstantRange pushConstantRange {
+		vk::ShaderStageFlagBits::eVertex,
+		0,
+		sizeof(ScenePushConstants)
+	};
+	return device.createPipelineLayoutUnique({ {}, 1, &sceneSetLayout, 1, &pushConstantRange });
+}
+
+static vk::UniquePipelineLayout BuildParticlePipelineLayout(
+	vk::Device const& device,
+	vk::DescriptorSetLayout const& sceneSetLayout,
+	vk::DescriptorSetLayout const& particleSetLayout
+) {
+	std::array<vk::DescriptorSetLayout, 2> setLayouts { sceneSetLayout, particleSetLayout };
+	vk::PushConstantRange pushConstantRange = ParticleSystem::DrawPushConstantRange();
+	return device.createPipelineLayoutUnique({
+		{},
+		static_cast<uint32_t>(setLayouts.size()), setLayouts.data(),
+		1, &pushConstantRange
+	});
+}
+
+ScenePipelines ScenePipelines::Build(
+	vk::Device const& device,
+	vk::Format format,
+	vk::DescriptorSetLayout const& sceneSetLayout,
+	vk::DescriptorSetLayout const& particleSetLayout
+) {
+	ScenePipelines scene;
+	scene.RenderPass = BuildRenderPass(device, format);
+	scene.Layout = BuildScenePipelineLayout(device, sceneSetLayout);
+	scene.Pipeline = BuildGraphicsPipeline(
+		device,
+		VertexShaderIL,
+		FragmentShaderIL,
+		BlendMode::Opaque,
+		*scene.Layout,
+		*scene.RenderPass
+	);
+	scene.ParticleLayout = BuildParticlePipelineLayout(device, sceneSetLayout, particleSetLayout);
+	scene.ParticlePipeline = BuildGraphicsPipeline(
+		device,
+		ParticleVertexShaderIL,
+		ParticleFragmentShaderIL,
+		BlendMode::Additive,
+		*scene.ParticleLayout,
+		*scene.RenderPass
+	);
+	return scene;
+}
+
+void RecordSceneCommands(
+	vk::CommandBuffer const& commandBuffer,
+	ScenePipelines const& scene,
+	vk::Framebuffer const& framebuffer,
+	vk::Extent2D const& extent,
+	vk::DescriptorSet const& sceneSet,
+	ParticleSystem const& particles,
+	float rotation
+) {
+	vk::ClearValue clearValue = vk::ClearColorValue(
+		std::array<float, 4> { 0.0f, 0.0f, 0.0f, 1.0f }
+	);
+	vk::RenderPassBeginInfo renderPassBegin {
+		*scene.RenderPass,
+		framebuffer,
+		vk::Rect2D { { 0, 0 }, extent },
+		1, &clearValue
+	};
+	commandBuffer.beginRenderPass(renderPassBegin, vk::SubpassContents::eInline);
+
+	vk::Viewport viewport {
+		0.0f,
+		0.0f,
+		static_cast<float>(extent.width),
+		static_cast<float>(extent.height),
+		0.0f,
+		1.0f
+	};
+	commandBuffer.setViewport(0, viewport);
+	commandBuffer.setScissor(0, vk::Rect2D { { 0, 0 }, extent });
+
+	ScenePushConstants pushConstants { rotation };
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *scene.Pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *scene.Layout, 0, sceneSet, nullptr);
+	commandBuffer.pushConstants(
+		*scene.Layout,
+		vk::ShaderStageFlagBits::eVertex,
+		0, sizeof(pushConstants), &pushConstants
+	);
+	commandBuffer.draw(9, 1, 0, 0);
+
+	// Particles are blended additively, so they don't need to be sorted.
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *scene.ParticlePipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *scene.ParticleLayout, 0, sceneSet, nullptr);
+	particles.RecordDraw(commandBuffer, *scene.ParticleLayout);
+	commandBuffer.endRenderPass();
+}
+}
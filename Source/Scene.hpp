@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ParticleSystem.hpp"
+#include "Vulkan.hpp"
+
+namespace py {
+// The render pass and pipelines that draw the scene into a render target of the given format.
+struct ScenePipelines {
+    vk::UniqueRenderPass RenderPass;
+    vk::UniquePipelineLayout Layout;
+    vk::UniquePipeline Pipeline;
+    vk::UniquePipelineLayout ParticleLayout;
+    vk::UniquePipeline ParticlePipeline;
+
+    static ScenePipelines Build(
+        vk::Device const &device,
+        vk::Format format,
+        vk::DescriptorSetLayout const &sceneSetLayout,
+        vk::DescriptorSetLayout const &particleSetLayout
+    );
+};
+
+// Draws the floor, the triangle and the particles into the framebuffer, leaving it ready to be transferred from.
+void RecordSceneCommands(
+    vk::CommandBuffer const &commandBuffer,
+    ScenePipelines const &scene,
+    vk::Framebuffer const &framebuffer,
+    vk::Extent2D const &extent,
+    vk::DescriptorSet const &sceneSet,
+    ParticleSystem const &particles,
+    float rotation
+);
+}
@@ -0,0 +1,12 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec4 FragmentColor;
+layout(location = 1) in vec2 Corner;
+layout(location = 0) out vec4 OutColor;
+
+void main() {
+	// Round off the quad, particles are blended additively so the color is premultiplied by the falloff.
+	float falloff = max(1.0 - dot(Corner, Corner), 0.0);
+	OutColor = vec4(FragmentColor.rgb * FragmentColor.a * falloff, 1.0);
+}
@@ -0,0 +1,58 @@
+#version 450
+#extension GL_KHR_vulkan_glsl: enable
+
+const float ParticleSize = 0.06;
+
+vec2 Corners[6] = vec2[](
+	vec2(-1.0, -1.0),
+	vec2(1.0, -1.0),
+	vec2(1.0, 1.0),
+	vec2(-1.0, -1.0),
+	vec2(1.0, 1.0),
+	vec2(-1.0, 1.0)
+);
+
+layout(set = 0, binding = 0) uniform SceneUniforms {
+	mat4 View;
+	mat4 Projection;
+	mat4 InverseProjection;
+	vec4 ViewportSize;
+	vec4 DepthRange;
+	uvec4 LightCount;
+} Scene;
+
+struct Particle {
+	vec4 PositionLife;
+	vec4 VelocityLifetime;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ParticleBuffer {
+	Particle Items[];
+} Particles;
+
+layout(std430, set = 1, binding = 2) readonly buffer AliveListBuffer {
+	uint Items[];
+} AliveLists;
+
+layout(push_constant) uniform PushConstants {
+	// The offset of the alive list that holds this frame's survivors.
+	uint AliveListOffset;
+} Push;
+
+layout(location = 0) out vec4 FragmentColor;
+layout(location = 1) out vec2 Corner;
+
+void main() {
+	uint particle = AliveLists.Items[Push.AliveListOffset + gl_VertexIndex / 6];
+	vec4 positionLife = Particles.Items[particle].PositionLife;
+	float age = 1.0 - positionLife.w / Particles.Items[particle].VelocityLifetime.w;
+
+	// Billboard the quad in view space.
+	Corner = Corners[gl_VertexIndex % 6];
+	vec4 viewPosition = Scene.View * vec4(positionLife.xyz, 1.0);
+	viewPosition.xy += Corner * ParticleSize;
+	gl_Position = Scene.Projection * viewPosition;
+
+	vec3 color = mix(vec3(1.0, 0.8, 0.3), vec3(0.9, 0.2, 0.05), age);
+	FragmentColor = vec4(color, 1.0 - age);
+}
@@ -0,0 +1,41 @@
+// Shared by the particle compute passes. Must match the layout in ParticleSystem.cpp.
+
+struct Particle {
+	vec4 PositionLife;
+	vec4 VelocityLifetime;
+};
+
+layout(std430, set = 0, binding = 0) buffer ParticleBuffer {
+	Particle Items[];
+} Particles;
+
+layout(std430, set = 0, binding = 1) buffer DeadListBuffer {
+	uint Items[];
+} DeadList;
+
+// Two lists of Capacity entries each, the survivors of one frame are compacted into the other.
+layout(std430, set = 0, binding = 2) buffer AliveListBuffer {
+	uint Items[];
+} AliveLists;
+
+// The indirect arguments come first so that they can be consumed straight from this buffer.
+layout(std430, set = 0, binding = 3) buffer ControlBuffer {
+	uvec4 EmitDispatch;
+	uvec4 SimulateDispatch;
+	uvec4 Draw;
+	uint Capacity;
+	uint DeadCount;
+	uint EmitCount;
+	uint Unused;
+	uint AliveCount[2];
+} Control;
+
+layout(push_constant) uniform PushConstants {
+	float DeltaTime;
+	float Time;
+	uint EmitRequest;
+	// The alive list that is appended to this frame. The survivors are moved to the other one.
+	uint Current;
+} Push;
+
+const uint GroupSize = 256;
@@ -1,9 +1,80 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Must match the constants in ClusteredLighting.hpp.
+const uvec3 ClusterCounts = uvec3(16, 9, 24);
+
+const vec3 AmbientLight = vec3(0.03);
+
+layout(set = 0, binding = 0) uniform SceneUniforms {
+	mat4 View;
+	mat4 Projection;
+	mat4 InverseProjection;
+	vec4 ViewportSize;
+	vec4 DepthRange;
+	uvec4 LightCount;
+} Scene;
+
+// In view space, ClusteredLighting transforms the lights when uploading them.
+struct Light {
+	vec4 PositionRange;
+	vec4 Color;
+	vec4 DirectionCosCone;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+	Light Items[];
+} LightBuffer;
+
+layout(std430, set = 0, binding = 2) readonly buffer ClusterRanges {
+	uvec2 Items[];
+} Ranges;
+
+layout(std430, set = 0, binding = 3) readonly buffer LightIndices {
+	uint Items[];
+} Indices;
+
 layout(location = 0) in vec3 FragmentColor;
+layout(location = 1) in vec3 ViewPosition;
+layout(location = 2) in vec3 ViewNormal;
 layout(location = 0) out vec4 OutColor;
 
+uint ClusterIndex() {
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / Scene.ViewportSize.xy * vec2(ClusterCounts.xy)), ClusterCounts.xy - 1);
+	float depthFraction = log(-ViewPosition.z / Scene.DepthRange.x) / Scene.DepthRange.z;
+	uint slice = uint(clamp(depthFraction * float(ClusterCounts.z), 0.0, float(ClusterCounts.z - 1)));
+	return tile.x + ClusterCounts.x * (tile.y + ClusterCounts.y * slice);
+}
+
 void main() {
-	OutColor = vec4(FragmentColor, 1.0);
+	// Light both sides of the surface, the triangle is seen from behind half of the time.
+	vec3 normal = normalize(ViewNormal);
+	if (dot(normal, ViewPosition) > 0.0) {
+		normal = -normal;
+	}
+	vec3 lighting = AmbientLight;
+
+	uvec2 range = Ranges.Items[ClusterIndex()];
+	for (uint i = 0; i < range.y; ++i) {
+		Light light = LightBuffer.Items[Indices.Items[range.x + i]];
+		vec3 toLight = light.PositionRange.xyz - ViewPosition;
+		float distance = length(toLight);
+		float lightRange = light.PositionRange.w;
+		if (distance >= lightRange) {
+			continue;
+		}
+
+		vec3 direction = toLight / distance;
+		float falloff = 1.0 - (distance * distance) / (lightRange * lightRange);
+		float attenuation = falloff * falloff;
+
+		float cosCone = light.DirectionCosCone.w;
+		if (cosCone > -1.0) {
+			attenuation *= smoothstep(cosCone, mix(cosCone, 1.0, 0.2), dot(-direction, light.DirectionCosCone.xyz));
+		}
+
+		lighting += light.Color.rgb * attenuation * max(dot(normal, direction), 0.0);
+	}
+
+	OutColor = vec4(FragmentColor * lighting, 1.0);
 }
@@ -1,21 +1,63 @@
 #version 450
 #extension GL_KHR_vulkan_glsl: enable
 
-vec2 Positions[3] = vec2[](
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
+// The first six vertices are the floor, the last three the spinning triangle.
+vec3 Positions[9] = vec3[](
+	vec3(-20.0, 0.0, -20.0),
+	vec3(20.0, 0.0, -20.0),
+	vec3(20.0, 0.0, 20.0),
+	vec3(-20.0, 0.0, -20.0),
+	vec3(20.0, 0.0, 20.0),
+	vec3(-20.0, 0.0, 20.0),
+	vec3(0.0, 3.5, 0.0),
+	vec3(1.5, 0.5, 0.0),
+	vec3(-1.5, 0.5, 0.0)
 );
 
-vec3 Colors[3] = vec3[](
+vec3 Colors[9] = vec3[](
+	vec3(0.8, 0.8, 0.8),
+	vec3(0.8, 0.8, 0.8),
+	vec3(0.8, 0.8, 0.8),
+	vec3(0.8, 0.8, 0.8),
+	vec3(0.8, 0.8, 0.8),
+	vec3(0.8, 0.8, 0.8),
 	vec3(1.0, 0.0, 0.0),
 	vec3(0.0, 1.0, 0.0),
 	vec3(0.0, 0.0, 1.0)
 );
 
+layout(set = 0, binding = 0) uniform SceneUniforms {
+	mat4 View;
+	mat4 Projection;
+	mat4 InverseProjection;
+	vec4 ViewportSize;
+	vec4 DepthRange;
+	uvec4 LightCount;
+} Scene;
+
+layout(push_constant) uniform PushConstants {
+	float Rotation;
+} Push;
+
 layout(location = 0) out vec3 FragmentColor;
+layout(location = 1) out vec3 ViewPosition;
+layout(location = 2) out vec3 ViewNormal;
 
 void main() {
-	gl_Position = vec4(Positions[gl_VertexIndex], 0.0, 1.0);
+	vec3 position = Positions[gl_VertexIndex];
+	vec3 normal = vec3(0.0, 1.0, 0.0);
+	if (gl_VertexIndex >= 6) {
+		// Spin the triangle around the vertical axis.
+		float s = sin(Push.Rotation);
+		float c = cos(Push.Rotation);
+		mat3 rotation = mat3(c, 0.0, -s, 0.0, 1.0, 0.0, s, 0.0, c);
+		position = rotation * position;
+		normal = rotation * vec3(0.0, 0.0, 1.0);
+	}
+
+	vec4 viewPosition = Scene.View * vec4(position, 1.0);
+	gl_Position = Scene.Projection * viewPosition;
 	FragmentColor = Colors[gl_VertexIndex];
+	ViewPosition = viewPosition.xyz;
+	ViewNormal = mat3(Scene.View) * normal;
 }
@@ -0,0 +1,113 @@
+#include "Simulation.hpp"
+
+#include <cmath>
+#include <random>
+
+namespace py {
+static constexpr double RotationSpeed = 1.0; // Radians per second.
+static constexpr double TwoPi = 6.283185307179586;
+
+// The lights are spread over a disc of this radius around the origin.
+static constexpr float LightFieldRadius = 18.0f;
+
+// The cosine of the half angle of every spot light's cone (35 degrees).
+static constexpr float SpotCosCone = 0.819152f;
+
+static glm::vec3 HueToColor(float hue) {
+	glm::vec3 color {
+		std::abs(hue * 6.0f - 3.0f) - 1.0f,
+		2.0f - std::abs(hue * 6.0f - 2.0f),
+		2.0f - std::abs(hue * 6.0f - 4.0f)
+	};
+	return glm::clamp(color, 0.0f, 1.0f);
+}
+
+Simulation::Simulation(std::chrono::nanoseconds tickInterval, uint32_t lightCount) : tickInterval(tickInterval) {
+	// A fixed seed keeps the scene identical from run to run.
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	orbits.reserve(lightCount);
+	initialLights.reserve(lightCount);
+	for (uint32_t i = 0; i < lightCount; ++i) {
+		orbits.push_back(LightOrbit {
+			LightFieldRadius * std::sqrt(unit(random)),
+			0.5f + 2.0f * unit(random),
+			static_cast<float>(TwoPi) * unit(random),
+			(unit(random) - 0.5f) * 0.6f
+		});
+
+		bool isSpot = i % 4 == 0;
+		float range = isSpot ? 4.0f + 2.0f * unit(random) : 1.5f + 2.0f * unit(random);
+		initialLights.push_back(Light {
+			glm::vec4 { 0.0f, 0.0f, 0.0f, range },
+			glm::vec4 { HueToColor(unit(random)) * (isSpot ? 2.0f : 1.0f), 0.0f },
+			glm::vec4 { 0.0f, -1.0f, 0.0f, isSpot ? SpotCosCone : -1.0f }
+		});
+	}
+}
+
+Simulation::~Simulation() {
+	Stop();
+}
+
+void Simulation::Start() {
+	if (running.exchange(true)) {
+		return;
+	}
+	thread = std::thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop() {
+	running.store(false, std::memory_order_release);
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+FrameState const& Simulation::Latest() {
+	states.Update();
+	return states.Front();
+}
+
+void Simulation::Step(FrameState& state, double deltaTime) const {
+	state.Tick++;
+	state.Time += deltaTime;
+	state.Rotation = static_cast<float>(std::fmod(state.Time * RotationSpeed, TwoPi));
+
+	float time = static_cast<float>(state.Time);
+	for (size_t i = 0; i < orbits.size(); ++i) {
+		LightOrbit const& orbit = orbits[i];
+		float angle = orbit.Phase + orbit.Speed * time;
+		state.Lights[i].PositionRange = glm::vec4 {
+			orbit.Radius * std::cos(angle),
+			orbit.Height,
+			orbit.Radius * std::sin(angle),
+			state.Lights[i].PositionRange.w
+		};
+	}
+}
+
+void Simulation::Run() {
+	using Clock = std::chrono::steady_clock;
+
+	// The authoritative state lives on this thread; published slots are only ever copies of it.
+	FrameState state;
+	state.Lights = initialLights;
+	double deltaTime = std::chrono::duration<double>(tickInterval).count();
+	Clock::time_point nextTick = Clock::now();
+	while (running.load(std::memory_order_acquire)) {
+		Step(state, deltaTime);
+		states.Back() = state;
+		states.Publish();
+
+		nextTick += tickInterval;
+		Clock::time_point now = Clock::now();
+		if (now > nextTick + tickInterval) {
+			// We fell behind (e.g. the process was suspended), so don't try to catch up all at once.
+			nextTick = now;
+		}
+		std::this_thread::sleep_until(nextTick);
+	}
+}
+}
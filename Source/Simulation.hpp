@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Light.hpp"
+#include "TripleBuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace py {
+// Everything the render thread needs to know about a simulated frame.
+struct FrameState {
+    uint64_t Tick = 0;
+    double Time = 0.0;
+    float Rotation = 0.0f;
+
+    glm::vec3 CameraPosition { 0.0f, 10.0f, 16.0f };
+    glm::vec3 CameraTarget { 0.0f, 0.0f, 0.0f };
+
+    std::vector<Light> Lights;
+};
+
+// Steps the world at a fixed rate on its own thread and publishes snapshots for the render thread.
+class Simulation {
+public:
+    Simulation(std::chrono::nanoseconds tickInterval, uint32_t lightCount);
+    ~Simulation();
+
+    Simulation(Simulation const &) = delete;
+    Simulation &operator=(Simulation const &) = delete;
+
+    void Start();
+    void Stop();
+
+    // Returns the most recently published snapshot. Must only be called from the render thread.
+    FrameState const &Latest();
+
+private:
+    // How a light moves around the scene.
+    struct LightOrbit {
+        float Radius;
+        float Height;
+        float Phase;
+        float Speed;
+    };
+
+    void Run();
+    void Step(FrameState &state, double deltaTime) const;
+
+    std::chrono::nanoseconds tickInterval;
+    std::vector<LightOrbit> orbits;
+    std::vector<Light> initialLights;
+    TripleBuffer<FrameState> states;
+    std::atomic<bool> running { false };
+    std::thread thread;
+};
+}
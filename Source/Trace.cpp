@@ -0,0 +1,188 @@
+#include "Trace.hpp"
+
+#include "CommandLine.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace py {
+static constexpr std::array<char, 4> TraceMagic { 'P', 'Y', 'T', 'R' };
+
+// Bump whenever the layout of a record changes. Traces are only meant to be replayed by the same version.
+static constexpr uint32_t TraceVersion = 2;
+
+TraceSettings TraceSettings::Parse(int argc, char** argv) {
+	TraceSettings settings;
+	for (int i = 1; i < argc; ++i) {
+		if (char const* value = OptionValue(argv[i], "--capture")) {
+			settings.CapturePath = value;
+		}
+	}
+	return settings;
+}
+
+TraceWriter::TraceWriter(std::string const& path) {
+	if (path.empty()) {
+		return;
+	}
+
+	out.open(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("failed to open trace for writing: " + path);
+	}
+	out.write(TraceMagic.data(), TraceMagic.size());
+	Write(TraceVersion);
+}
+
+void TraceWriter::Write(vk::Extent2D const& extent) {
+	Write(extent.width);
+	Write(extent.height);
+}
+
+void TraceWriter::CreateParticleSystem(TraceParticleSystem const& particles) {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::CreateParticleSystem);
+	Write(particles.Capacity);
+	Write(particles.EmitRate);
+}
+
+void TraceWriter::CreateFrameResources(TraceFrameResources const& resources) {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::CreateFrameResources);
+	Write(static_cast<int32_t>(resources.Format));
+	Write(resources.Extent);
+	Write(resources.FrameCount);
+	Write(resources.LightCount);
+}
+
+void TraceWriter::BeginFrame(TraceBeginFrame const& frame) {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::BeginFrame);
+	Write(frame.Slot);
+}
+
+void TraceWriter::UploadLighting(SceneUniforms const& uniforms, std::vector<Light> const& lights) {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::UploadLighting);
+	Write(uniforms);
+	Write(static_cast<uint32_t>(lights.size()));
+	out.write(reinterpret_cast<char const*>(lights.data()), lights.size() * sizeof(Light));
+}
+
+void TraceWriter::CullLights() {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::CullLights);
+}
+
+void TraceWriter::SimulateParticles(TraceParticleStep const& step) {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::SimulateParticles);
+	Write(step.DeltaTime);
+	Write(step.Time);
+}
+
+void TraceWriter::DrawScene(TraceSceneDraw const& draw) {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::DrawScene);
+	Write(draw.Extent);
+	Write(draw.Rotation);
+}
+
+void TraceWriter::EndFrame() {
+	if (!IsOpen()) {
+		return;
+	}
+	Write(TraceOp::EndFrame);
+}
+
+TraceReader::TraceReader(std::string const& path) : in(path, std::ios::binary) {
+	if (!in) {
+		throw std::runtime_error("failed to open trace: " + path);
+	}
+
+	std::array<char, 4> magic {};
+	in.read(magic.data(), magic.size());
+	if (!in || magic != TraceMagic) {
+		throw std::runtime_error("not a Pyrite trace: " + path);
+	}
+	uint32_t version = Read<uint32_t>();
+	if (version != TraceVersion) {
+		throw std::runtime_error("unsupported trace version " + std::to_string(version));
+	}
+}
+
+std::optional<TraceOp> TraceReader::NextOp() {
+	uint8_t op;
+	if (!in.read(reinterpret_cast<char*>(&op), sizeof(op))) {
+		return std::nullopt;
+	}
+	if (op < static_cast<uint8_t>(TraceOp::CreateParticleSystem) || op > static_cast<uint8_t>(TraceOp::EndFrame)) {
+		throw std::runtime_error("unknown trace operation " + std::to_string(op));
+	}
+	return static_cast<TraceOp>(op);
+}
+
+vk::Extent2D TraceReader::ReadExtent() {
+	uint32_t width = Read<uint32_t>();
+	uint32_t height = Read<uint32_t>();
+	return vk::Extent2D { width, height };
+}
+
+TraceParticleSystem TraceReader::ReadParticleSystem() {
+	TraceParticleSystem particles;
+	particles.Capacity = Read<uint32_t>();
+	particles.EmitRate = Read<double>();
+	return particles;
+}
+
+TraceFrameResources TraceReader::ReadFrameResources() {
+	TraceFrameResources resources;
+	resources.Format = static_cast<vk::Format>(Read<int32_t>());
+	resources.Extent = ReadExtent();
+	resources.FrameCount = Read<uint32_t>();
+	resources.LightCount = Read<uint32_t>();
+	return resources;
+}
+
+TraceBeginFrame TraceReader::ReadBeginFrame() {
+	return TraceBeginFrame { Read<uint32_t>() };
+}
+
+TraceLightingUpload TraceReader::ReadLightingUpload() {
+	TraceLightingUpload upload;
+	upload.Uniforms = Read<SceneUniforms>();
+	upload.Lights.resize(Read<uint32_t>());
+	if (!in.read(reinterpret_cast<char*>(upload.Lights.data()), upload.Lights.size() * sizeof(Light))) {
+		throw std::runtime_error("trace is truncated");
+	}
+	return upload;
+}
+
+TraceParticleStep TraceReader::ReadParticleStep() {
+	TraceParticleStep step;
+	step.DeltaTime = Read<float>();
+	step.Time = Read<float>();
+	return step;
+}
+
+TraceSceneDraw TraceReader::ReadSceneDraw() {
+	TraceSceneDraw draw;
+	draw.Extent = ReadExtent();
+	draw.Rotation = Read<float>();
+	return draw;
+}
+}
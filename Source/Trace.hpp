@@ -0,0 +1,130 @@
+#pragma once
+
+#define NOMINMAX
+#include <vulkan/vulkan.hpp>
+
+#include "ClusteredLighting.hpp"
+#include "Light.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace py {
+// The operations recorded into a trace, in the order the renderer issues them.
+enum class TraceOp : uint8_t {
+    CreateParticleSystem = 1,
+    CreateFrameResources,
+    BeginFrame,
+    UploadLighting,
+    CullLights,
+    SimulateParticles,
+    DrawScene,
+    EndFrame
+};
+
+struct TraceParticleSystem {
+    uint32_t Capacity;
+    double EmitRate;
+};
+
+// The render targets, lighting buffers and scene pipelines rebuilt whenever the swapchain is.
+struct TraceFrameResources {
+    vk::Format Format;
+    vk::Extent2D Extent;
+    uint32_t FrameCount;
+    uint32_t LightCount;
+};
+
+struct TraceBeginFrame {
+    uint32_t Slot;
+};
+
+// Exactly what was uploaded, so that a trace replays the same workload whatever the simulation in the tree does.
+struct TraceLightingUpload {
+    SceneUniforms Uniforms;
+
+    // Empty before the simulation has published its first snapshot.
+    std::vector<Light> Lights;
+};
+
+struct TraceParticleStep {
+    float DeltaTime;
+    float Time;
+};
+
+struct TraceSceneDraw {
+    vk::Extent2D Extent;
+    float Rotation;
+};
+
+struct TraceSettings {
+    // Where to write the trace. Empty disables capture.
+    std::string CapturePath;
+
+    // Reads --capture= from the command line.
+    static TraceSettings Parse(int argc, char **argv);
+};
+
+// Records the renderer's operations into a compact binary trace that PyriteReplay can play back. Every call is
+// a no-op if the writer wasn't given a path.
+class TraceWriter {
+public:
+    explicit TraceWriter(std::string const &path);
+
+    bool IsOpen() const { return out.is_open(); }
+
+    void CreateParticleSystem(TraceParticleSystem const &particles);
+    void CreateFrameResources(TraceFrameResources const &resources);
+    void BeginFrame(TraceBeginFrame const &frame);
+    void UploadLighting(SceneUniforms const &uniforms, std::vector<Light> const &lights);
+    void CullLights();
+    void SimulateParticles(TraceParticleStep const &step);
+    void DrawScene(TraceSceneDraw const &draw);
+    void EndFrame();
+
+private:
+    template <typename T>
+    void Write(T value) {
+        out.write(reinterpret_cast<char const *>(&value), sizeof(value));
+    }
+
+    void Write(vk::Extent2D const &extent);
+
+    std::ofstream out;
+};
+
+// Reads a trace back one operation at a time. After NextOp() returns an operation, its payload (if any) must be
+// read with the matching Read function before asking for the next one.
+class TraceReader {
+public:
+    explicit TraceReader(std::string const &path);
+
+    // Returns nothing at the end of the trace.
+    std::optional<TraceOp> NextOp();
+
+    TraceParticleSystem ReadParticleSystem();
+    TraceFrameResources ReadFrameResources();
+    TraceBeginFrame ReadBeginFrame();
+    TraceLightingUpload ReadLightingUpload();
+    TraceParticleStep ReadParticleStep();
+    TraceSceneDraw ReadSceneDraw();
+
+private:
+    template <typename T>
+    T Read() {
+        T value;
+        if (!in.read(reinterpret_cast<char *>(&value), sizeof(value))) {
+            throw std::runtime_error("trace is truncated");
+        }
+        return value;
+    }
+
+    vk::Extent2D ReadExtent();
+
+    std::ifstream in;
+};
+}
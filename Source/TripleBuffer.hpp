@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace py {
+// Lock-free single-producer, single-consumer exchange of the latest value. The producer fills its back slot and
+// publishes it, the consumer picks up whatever was published last; neither side ever waits on the other.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(TripleBuffer const &) = delete;
+    TripleBuffer &operator=(TripleBuffer const &) = delete;
+
+    // The slot currently owned by the producer.
+    T &Back() { return slots[back]; }
+
+    // Hands the back slot over to the consumer and takes ownership of the previously shared slot.
+    void Publish() {
+        uint8_t previous = shared.exchange(static_cast<uint8_t>(back | FreshBit), std::memory_order_acq_rel);
+        back = previous & IndexMask;
+    }
+
+    // Swaps in the most recently published slot, if there is one. Returns whether the front slot changed.
+    bool Update() {
+        if ((shared.load(std::memory_order_acquire) & FreshBit) == 0) {
+            return false;
+        }
+
+        uint8_t previous = shared.exchange(front, std::memory_order_acq_rel);
+        front = previous & IndexMask;
+        return true;
+    }
+
+    // The slot currently owned by the consumer.
+    T const &Front() const { return slots[front]; }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t FreshBit = 0x4;
+
+    std::array<T, 3> slots {};
+    uint8_t back = 0;
+    std::atomic<uint8_t> shared { 1 };
+    uint8_t front = 2;
+};
+}
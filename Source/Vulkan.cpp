@@ -1,7 +1,8 @@
 #include "Vulkan.hpp"
 
+#include "DebugMessageSink.hpp"
+
 #include <algorithm>
-#include <iostream>
 #include <limits>
 #include <unordered_set>
 
@@ -23,7 +24,8 @@ vk::UniqueInstance InitializeVulkan(
 	vk::ApplicationInfo const& appInfo,
 	std::vector<std::string> const& extensions,
 	std::vector<std::string> const& validationLayers,
-	bool enableDebug
+	bool enableDebug,
+	DebugMessageSink* debugSink
 ) {
 	std::vector<char const*> extensionsPtrs;
 	extensionsPtrs.reserve(extensions.size());
@@ -49,7 +51,7 @@ vk::UniqueInstance InitializeVulkan(
 
 	if (enableDebug) {
 		createInfoChain.get<vk::DebugUtilsMessengerCreateInfoEXT>() =
-			BuildDebugMessengerCreateInfo();
+			BuildDebugMessengerCreateInfo(debugSink);
 	}
 	else {
 		createInfoChain.unlink<vk::DebugUtilsMessengerCreateInfoEXT>();
@@ -67,11 +69,15 @@ VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessengerCallback(
 	VkDebugUtilsMessengerCallbackDataEXT const* callbackData,
 	void* userData
 ) {
-	std::cerr << "[Vulkan Debug] " << callbackData->pMessage << std::endl;
+	// This may be called from any driver thread, so don't do any I/O here.
+	if (userData == nullptr) {
+		return VK_FALSE;
+	}
+	static_cast<DebugMessageSink*>(userData)->Push(messageSeverity, messageType, callbackData);
 	return VK_FALSE;
 }
 
-vk::DebugUtilsMessengerCreateInfoEXT BuildDebugMessengerCreateInfo() {
+vk::DebugUtilsMessengerCreateInfoEXT BuildDebugMessengerCreateInfo(DebugMessageSink* sink) {
 	return vk::DebugUtilsMessengerCreateInfoEXT {
 		{},
 		vk::DebugUtilsMessageSeverityFlagsEXT {
@@ -84,11 +90,11 @@ vk::DebugUtilsMessengerCreateInfoEXT BuildDebugMessengerCreateInfo() {
 			vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation
 		},
 		&DebugMessengerCallback,
-		nullptr
+		sink
 	};
 }
 
-PhysicalDeviceDetails PhysicalDeviceDetails::Build(vk::PhysicalDevice const& physicalDevice, vk::SurfaceKHR const& surface) {
+PhysicalDeviceDetails PhysicalDeviceDetails::Build(vk::PhysicalDevice const& physicalDevice) {
 	PhysicalDeviceDetails details {
 		physicalDevice,
 		physicalDevice.getFeatures(),
@@ -102,13 +108,30 @@ PhysicalDeviceDetails PhysicalDeviceDetails::Build(vk::PhysicalDevice const& phy
 		if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
 			details.GraphicsFamilyIndex = index;
 		}
+		index++;
+	}
+
+	details.HasMemoryBudget = std::any_of(details.Extensions.cbegin(), details.Extensions.cend(),
+		[](vk::ExtensionProperties const& e) {
+			return std::strcmp(e.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+		}
+	);
+	details.HasTimelineSemaphore = std::any_of(details.Extensions.cbegin(), details.Extensions.cend(),
+		[](vk::ExtensionProperties const& e) {
+			return std::strcmp(e.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+		}
+	);
+	return details;
+}
+
+PhysicalDeviceDetails PhysicalDeviceDetails::Build(vk::PhysicalDevice const& physicalDevice, vk::SurfaceKHR const& surface) {
+	PhysicalDeviceDetails details = Build(physicalDevice);
 
+	for (uint32_t index = 0; index < details.QueueFamilies.size(); ++index) {
 		if (physicalDevice.getSurfaceSupportKHR(index, surface)) {
 			// Does the device support presenting to the surface through the current queue?
 			details.PresentFamilyIndex = index;
 		}
-
-		index++;
 	}
 
 	details.Capabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
@@ -143,7 +166,8 @@ vk::UniqueDevice BuildDevice(
 	std::unordered_set<uint32_t> const& queueFamilyIndexes,
 	std::vector<std::string> const& extensions,
 	std::vector<std::string> const& validationLayers,
-	bool enableDebug
+	bool enableDebug,
+	void const* next
 ) {
 	float queuePriority = 1.0;
 	std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
@@ -172,6 +196,7 @@ vk::UniqueDevice BuildDevice(
 		static_cast<uint32_t>(validationLayersPtrs.size()), validationLayersPtrs.data(),
 		static_cast<uint32_t>(extensionsPtrs.size()), extensionsPtrs.data(),
 	};
+	deviceCreateInfo.pNext = next;
 
 	vk::UniqueDevice logicalDevice = device.createDeviceUnique(deviceCreateInfo);
 	VULKAN_HPP_DEFAULT_DISPATCHER.init(*logicalDevice);
@@ -206,6 +231,29 @@ PhysicalDeviceDetails ChoosePhysicalDevice(vk::Instance const& instance, vk::Sur
 	return std::move(*bestAvailableDevice);
 }
 
+PhysicalDeviceDetails ChooseHeadlessPhysicalDevice(vk::Instance const& instance) {
+	std::optional<PhysicalDeviceDetails> bestAvailableDevice;
+	for (auto const& device : instance.enumeratePhysicalDevices()) {
+		PhysicalDeviceDetails details = PhysicalDeviceDetails::Build(device);
+		if (!details.GraphicsFamilyIndex) {
+			continue;
+		}
+
+		if (details.Properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
+			return details;
+		}
+		if (!bestAvailableDevice || bestAvailableDevice->Properties.deviceType == vk::PhysicalDeviceType::eCpu) {
+			bestAvailableDevice = details;
+		}
+	}
+
+	if (!bestAvailableDevice) {
+		throw std::runtime_error("failed to find a device with a graphics queue");
+	}
+
+	return std::move(*bestAvailableDevice);
+}
+
 static vk::SurfaceFormatKHR ChooseSwapSurfaceFormat(std::vector<vk::SurfaceFormatKHR> const& formats) {
 	for (auto const& format : formats) {
 		if (format.format == vk::Format::eB8G8R8A8Srgb &&
@@ -216,12 +264,16 @@ static vk::SurfaceFormatKHR ChooseSwapSurfaceFormat(std::vector<vk::SurfaceForma
 	return formats.front();
 }
 
-static vk::PresentModeKHR ChooseSwapPresentMode(std::vector<vk::PresentModeKHR> const& modes) {
+static vk::PresentModeKHR ChooseSwapPresentMode(
+	std::vector<vk::PresentModeKHR> const& modes,
+	vk::PresentModeKHR preferredMode
+) {
 	for (auto const& mode : modes) {
-		if (mode == vk::PresentModeKHR::eMailbox) {
+		if (mode == preferredMode) {
 			return mode;
 		}
 	}
+	// FIFO is the only mode every surface is required to support.
 	return vk::PresentModeKHR::eFifo;
 }
 
@@ -242,25 +294,37 @@ void SwapchainDetails::Initialize(
 	vk::Extent2D const& windowExtent,
 	vk::SurfaceKHR const& surface,
 	PhysicalDeviceDetails const& physicalDevice,
-	vk::Device const& device
+	vk::Device const& device,
+	vk::PresentModeKHR preferredPresentMode,
+	uint32_t desiredImageCount
 ) {
+	if (!(physicalDevice.Capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst)) {
+		// The scene is rendered offscreen and blitted into the swapchain.
+		throw std::runtime_error("surface does not support transfers into swapchain images");
+	}
+
 	vk::SurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(physicalDevice.Formats);
 	Format = surfaceFormat.format;
-	vk::PresentModeKHR presentMode = ChooseSwapPresentMode(physicalDevice.PresentModes);
+	PresentMode = ChooseSwapPresentMode(physicalDevice.PresentModes, preferredPresentMode);
 	Extent = ChooseSwapExtent(windowExtent, physicalDevice.Capabilities);
 
 	uint32_t minImages = physicalDevice.Capabilities.minImageCount + 1;
 	uint32_t maxImages = physicalDevice.Capabilities.maxImageCount;
+	uint32_t imageCount = std::max(minImages, desiredImageCount);
+	if (maxImages != 0) {
+		// A maximum of 0 means that there is no limit.
+		imageCount = std::min(maxImages, imageCount);
+	}
 
 	vk::SwapchainCreateInfoKHR createInfo {
 		{},
 		surface,
-		std::min(maxImages, minImages),
+		imageCount,
 		Format,
 		surfaceFormat.colorSpace,
 		Extent,
 		1,
-		vk::ImageUsageFlagBits::eColorAttachment
+		vk::ImageUsageFlagBits::eTransferDst
 	};
 
 	uint32_t queueFamilyIndices[] = {
@@ -281,7 +345,7 @@ void SwapchainDetails::Initialize(
 	// The window shouldn't be transparent.
 	createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
 
-	createInfo.presentMode = presentMode;
+	createInfo.presentMode = PresentMode;
 	createInfo.clipped = true;
 	createInfo.oldSwapchain = *Swapchain;
 
@@ -289,52 +353,87 @@ void SwapchainDetails::Initialize(
 	Swapchain = {};
 	Images = device.getSwapchainImagesKHR(*swapchain);
 
-	ImageViews.clear();
-	ImageViews.reserve(Images.size());
-	for (auto const& image : Images) {
-		vk::ImageViewCreateInfo createInfo {
-			{},
-			image,
-			vk::ImageViewType::e2D,
-			Format,
-			vk::ComponentMapping {
-				vk::ComponentSwizzle::eIdentity,
-				vk::ComponentSwizzle::eIdentity,
-				vk::ComponentSwizzle::eIdentity,
-				vk::ComponentSwizzle::eIdentity,
-			},
-			vk::ImageSubresourceRange {
-				vk::ImageAspectFlagBits::eColor,
-				0,
-				1,
-				0,
-				1
-			}
-		};
-		ImageViews.emplace_back(device.createImageViewUnique(createInfo));
+	Swapchain = std::move(swapchain);
+}
+
+vk::UniqueImageView BuildImageView(vk::Device const& device, vk::Image const& image, vk::Format format) {
+	vk::ImageViewCreateInfo createInfo {
+		{},
+		image,
+		vk::ImageViewType::e2D,
+		format,
+		vk::ComponentMapping {
+			vk::ComponentSwizzle::eIdentity,
+			vk::ComponentSwizzle::eIdentity,
+			vk::ComponentSwizzle::eIdentity,
+			vk::ComponentSwizzle::eIdentity,
+		},
+		vk::ImageSubresourceRange {
+			vk::ImageAspectFlagBits::eColor,
+			0,
+			1,
+			0,
+			1
+		}
+	};
+	return device.createImageViewUnique(createInfo);
+}
+
+uint32_t FindMemoryType(
+	vk::PhysicalDeviceMemoryProperties const& memoryProperties,
+	uint32_t memoryTypeBits,
+	vk::MemoryPropertyFlags properties
+) {
+	for (uint32_t index = 0; index < memoryProperties.memoryTypeCount; ++index) {
+		bool allowed = (memoryTypeBits & (1u << index)) != 0;
+		if (allowed && (memoryProperties.memoryTypes[index].propertyFlags & properties) == properties) {
+			return index;
+		}
 	}
+	throw std::runtime_error("failed to find a suitable memory type");
+}
 
-	Swapchain = std::move(swapchain);
+DeviceMemory AllocateMemory(
+	MemoryTelemetry& telemetry,
+	vk::Device const& device,
+	vk::MemoryRequirements const& requirements,
+	vk::MemoryPropertyFlags properties,
+	MemoryTag tag
+) {
+	uint32_t memoryTypeIndex = FindMemoryType(telemetry.MemoryProperties(), requirements.memoryTypeBits, properties);
+	return DeviceMemory(
+		device.allocateMemoryUnique({ requirements.size, memoryTypeIndex }),
+		telemetry,
+		tag,
+		memoryTypeIndex,
+		requirements.size
+	);
 }
 
-std::vector<vk::UniqueFramebuffer> SwapchainDetails::BuildFramebuffers(
+Buffer Buffer::Build(
+	MemoryTelemetry& telemetry,
 	vk::Device const& device,
-	vk::RenderPass const& renderpass
-) const {
-	std::vector<vk::UniqueFramebuffer> framebuffers;
-	framebuffers.reserve(ImageViews.size());
-	for (auto const& view : ImageViews) {
-		vk::FramebufferCreateInfo createInfo {
-			{},
-			renderpass,
-			1, &*view,
-			Extent.width,
-			Extent.height,
-			1
-		};
-		framebuffers.emplace_back(device.createFramebufferUnique(createInfo));
+	vk::DeviceSize size,
+	vk::BufferUsageFlags usage,
+	vk::MemoryPropertyFlags properties,
+	MemoryTag tag
+) {
+	Buffer buffer;
+	buffer.Size = size;
+	buffer.Handle = device.createBufferUnique({ {}, size, usage, vk::SharingMode::eExclusive });
+	buffer.Memory = AllocateMemory(
+		telemetry,
+		device,
+		device.getBufferMemoryRequirements(*buffer.Handle),
+		properties,
+		tag
+	);
+	device.bindBufferMemory(*buffer.Handle, *buffer.Memory, 0);
+
+	if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+		buffer.Mapped = device.mapMemory(*buffer.Memory, 0, VK_WHOLE_SIZE);
 	}
-	return framebuffers;
+	return buffer;
 }
 
 vk::UniqueShaderModule BuildShaderModule(vk::Device const& device, std::vector<uint32_t> const& il) {
@@ -3,12 +3,16 @@
 #define NOMINMAX
 #include <vulkan/vulkan.hpp>
 
+#include "MemoryTelemetry.hpp"
+
 #include <optional>
 #include <string>
 #include <vector>
 #include <unordered_set>
 
 namespace py {
+class DebugMessageSink;
+
 // Initializes the default dispatcher for extension methods.
 void InitializeDefaultDispatcher();
 
@@ -18,10 +22,12 @@ vk::UniqueInstance InitializeVulkan(
     vk::ApplicationInfo const &appInfo,
     std::vector<std::string> const &extensions,
     std::vector<std::string> const &validationLayers,
-    bool enableDebug
+    bool enableDebug,
+    DebugMessageSink *debugSink
 );
 
-// Invoked by the debug messenger to report on an event.
+// Invoked by the debug messenger to report on an event. Forwards the event to the DebugMessageSink passed as the
+// user data.
 VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessengerCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
     VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -29,9 +35,10 @@ VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessengerCallback(
     void *userData
 );
 
-vk::DebugUtilsMessengerCreateInfoEXT BuildDebugMessengerCreateInfo();
+vk::DebugUtilsMessengerCreateInfoEXT BuildDebugMessengerCreateInfo(DebugMessageSink *sink);
 
-// Details regarding a physical device in-relation to a surface.
+// Details regarding a physical device in-relation to a surface. Headless details leave the present queue and
+// swapchain details empty.
 struct PhysicalDeviceDetails {
     vk::PhysicalDevice Device;
     vk::PhysicalDeviceFeatures Features;
@@ -48,39 +55,88 @@ struct PhysicalDeviceDetails {
     std::vector<vk::SurfaceFormatKHR> Formats;
     std::vector<vk::PresentModeKHR> PresentModes;
 
+    // Whether VK_EXT_memory_budget is available.
+    bool HasMemoryBudget = false;
+
+    // Whether VK_KHR_timeline_semaphore is available.
+    bool HasTimelineSemaphore = false;
+
+    static PhysicalDeviceDetails Build(vk::PhysicalDevice const &device);
     static PhysicalDeviceDetails Build(vk::PhysicalDevice const &device, vk::SurfaceKHR const &surface);
 
     bool IsSuitable() const;
 };
 
+// The next pointer is chained into the device create info, e.g. to enable the features of an extension.
 vk::UniqueDevice BuildDevice(
     vk::PhysicalDevice const &device,
     std::unordered_set<uint32_t> const &queueFamilyIndexes,
     std::vector<std::string> const &extensions,
     std::vector<std::string> const &validationLayers,
-    bool enableDebug
+    bool enableDebug,
+    void const *next = nullptr
 );
 
 // Chooses the best physical device for the given instance and surface.
 PhysicalDeviceDetails ChoosePhysicalDevice(vk::Instance const &instance, vk::SurfaceKHR const &surface);
 
+// Chooses the best physical device for rendering without a surface. Software implementations such as lavapipe
+// are accepted when nothing else is available.
+PhysicalDeviceDetails ChooseHeadlessPhysicalDevice(vk::Instance const &instance);
+
 struct SwapchainDetails {
     vk::UniqueSwapchainKHR Swapchain;
     vk::Format Format;
     vk::Extent2D Extent;
+    vk::PresentModeKHR PresentMode;
     std::vector<vk::Image> Images;
-    std::vector<vk::UniqueImageView> ImageViews;
 
     // Initializes the swapchain with the given arguments and, if available, the previous swapchain.
+    // The preferred present mode is used if the surface supports it, and an image count of 0 leaves the number of
+    // images up to the surface.
     void Initialize(
             vk::Extent2D const &windowExtent,
             vk::SurfaceKHR const &surface,
             PhysicalDeviceDetails const &physicalDevice,
-            vk::Device const &device
+            vk::Device const &device,
+            vk::PresentModeKHR preferredPresentMode,
+            uint32_t desiredImageCount
     );
+};
 
-    std::vector<vk::UniqueFramebuffer>
-    BuildFramebuffers(vk::Device const &device, vk::RenderPass const &renderpass) const;
+vk::UniqueImageView BuildImageView(vk::Device const &device, vk::Image const &image, vk::Format format);
+
+// Finds a memory type allowed by the given bits that has all of the given properties.
+uint32_t FindMemoryType(
+    vk::PhysicalDeviceMemoryProperties const &memoryProperties,
+    uint32_t memoryTypeBits,
+    vk::MemoryPropertyFlags properties
+);
+
+// Allocates memory that is attributed to the given tag for as long as it lives.
+DeviceMemory AllocateMemory(
+    MemoryTelemetry &telemetry,
+    vk::Device const &device,
+    vk::MemoryRequirements const &requirements,
+    vk::MemoryPropertyFlags properties,
+    MemoryTag tag
+);
+
+// A buffer bound to its own allocation. Host visible buffers stay mapped for their whole lifetime.
+struct Buffer {
+    vk::UniqueBuffer Handle;
+    DeviceMemory Memory;
+    vk::DeviceSize Size = 0;
+    void *Mapped = nullptr;
+
+    static Buffer Build(
+        MemoryTelemetry &telemetry,
+        vk::Device const &device,
+        vk::DeviceSize size,
+        vk::BufferUsageFlags usage,
+        vk::MemoryPropertyFlags properties,
+        MemoryTag tag
+    );
 };
 
 vk::UniqueShaderModule BuildShaderModule(vk::Device const &device, std::vector<uint32_t> const &il);